@@ -0,0 +1,291 @@
+// Micro and scaling benchmarks for the packing engine. Prints one JSON
+// document to stdout so results can be diffed between releases.
+//
+//   benchmark [--max-items N] [--seed S] [--quick]
+//
+// Scaling runs go from 100 items up to --max-items (default 10000) in steps
+// of 10x for each bin mix; pass --max-items 100000 for the full range. Each
+// runs in a child process where fork() is available, so its peak_rss_kb is
+// that run's own peak (on top of the small footprint it starts from) rather
+// than the largest run so far.
+#include "packer.h"
+#include "bin.h"
+#include "item.h"
+#include "placed_boxes.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Peak resident set size of this process in KiB (0 where unsupported). The
+// counter never goes down, hence one process per scaling run.
+long peakRssKb() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// Keeps the optimiser from discarding benchmarked work.
+volatile long sink = 0;
+
+struct MicroResult {
+    std::string name;
+    size_t iterations;
+    double ns_per_op;
+};
+
+MicroResult runMicro(const std::string& name, size_t iterations, const std::function<void()>& op) {
+    op();  // warm-up
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        op();
+    }
+    return {name, iterations, secondsSince(start) * 1e9 / iterations};
+}
+
+// Warehouse-like SKU catalogue: a few dozen carton sizes in millimetres.
+std::vector<Item> generateItems(size_t count, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<long> edge(150, 1200);
+    std::uniform_real_distribution<float> weight(0.5f, 40.0f);
+    std::vector<Item> skus;
+    for (int s = 0; s < 40; ++s) {
+        skus.emplace_back("SKU " + std::to_string(s), edge(rng), edge(rng), edge(rng),
+                          std::vector<RotationType>{}, "#000000", weight(rng));
+    }
+    std::vector<Item> items;
+    items.reserve(count);
+    std::uniform_int_distribution<size_t> pick(0, skus.size() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        items.push_back(skus[pick(rng)]);
+    }
+    return items;
+}
+
+struct BinMix {
+    const char* name;
+    std::vector<Bin> types;
+};
+
+std::vector<BinMix> binMixes() {
+    return {
+        {"trailer", {Bin("Trailer 13.6m", 2480, 2650, 13600)}},
+        {"containers", {Bin("20ft", 2352, 2393, 5898), Bin("40ft", 2352, 2393, 12032)}},
+        {"pallet_boxes", {Bin("Small", 1200, 1000, 1200), Bin("Medium", 1200, 1600, 1200), Bin("Large", 1200, 2200, 1200)}},
+    };
+}
+
+// Enough bins of the mix, round-robin, to hold the items by volume with slack.
+std::vector<Bin> binsFor(const BinMix& mix, const ItemArena& items) {
+    long item_volume = 0;
+    for (const auto& item : items) {
+        item_volume += item.getVolume();
+    }
+    long mix_volume = 0;
+    for (const auto& bin : mix.types) {
+        mix_volume += bin.getVolume();
+    }
+    const size_t rounds = static_cast<size_t>(1.5 * item_volume / mix_volume) + 1;
+    std::vector<Bin> bins;
+    for (size_t r = 0; r < rounds; ++r) {
+        for (const auto& bin : mix.types) {
+            bins.push_back(bin);
+        }
+    }
+    return bins;
+}
+
+std::string runScaling(const BinMix& mix, size_t count, uint64_t seed) {
+    Packer packer;
+    for (const auto& item : generateItems(count, seed)) {
+        packer.addItem(item);
+    }
+    for (const auto& bin : binsFor(mix, packer.getItems())) {
+        packer.addBin(bin);
+    }
+
+    auto start = Clock::now();
+    packer.pack();
+    const double seconds = secondsSince(start);
+
+    const size_t attempts = packer.stats().put_attempts;
+    size_t placed = 0, used_bins = 0;
+    long packed_volume = 0, used_volume = 0;
+    for (const auto& bin : packer.getBins()) {
+        if (bin.itemCount() == 0) continue;
+        ++used_bins;
+        used_volume += bin.getVolume();
+        for (const auto& item : bin.getItems()) {
+            ++placed;
+            packed_volume += item.get().getVolume();
+        }
+    }
+
+    std::ostringstream out;
+    out << "{\"mix\": \"" << mix.name << "\", \"items\": " << count
+        << ", \"seed\": " << seed
+        << ", \"seconds\": " << seconds
+        << ", \"placed\": " << placed
+        << ", \"unfit\": " << packer.getUnfitItems().size()
+        << ", \"bins_used\": " << used_bins
+        << ", \"placements_per_second\": " << (seconds > 0 ? placed / seconds : 0.0)
+        << ", \"attempts_per_placement\": " << (placed ? static_cast<double>(attempts) / placed : 0.0)
+        << ", \"volume_utilisation\": " << (used_volume ? static_cast<double>(packed_volume) / used_volume : 0.0)
+        << ", \"peak_rss_kb\": " << peakRssKb() << "}";
+    return out.str();
+}
+
+// runScaling in a child process, falling back to this one if it cannot fork.
+std::string runScalingIsolated(const BinMix& mix, size_t count, uint64_t seed) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fds[2];
+    if (pipe(fds) == 0) {
+        const pid_t child = fork();
+        if (child == 0) {
+            close(fds[0]);
+            const std::string row = runScaling(mix, count, seed);
+            for (size_t written = 0; written < row.size();) {
+                const ssize_t n = write(fds[1], row.data() + written, row.size() - written);
+                if (n <= 0) _exit(1);
+                written += static_cast<size_t>(n);
+            }
+            _exit(0);
+        }
+        close(fds[1]);
+        if (child > 0) {
+            std::string row;
+            char buffer[4096];
+            ssize_t n;
+            while ((n = read(fds[0], buffer, sizeof(buffer))) > 0) {
+                row.append(buffer, static_cast<size_t>(n));
+            }
+            close(fds[0]);
+            int status = 0;
+            waitpid(child, &status, 0);
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                return row;
+            }
+            return "{\"mix\": \"" + std::string(mix.name) + "\", \"items\": " + std::to_string(count) +
+                   ", \"error\": \"run failed\"}";
+        }
+        close(fds[0]);
+    }
+#endif
+    return runScaling(mix, count, seed);
+}
+
+std::vector<MicroResult> runMicros(size_t scale) {
+    std::vector<MicroResult> results;
+
+    Item a("A", 400, 300, 200);
+    Item b("B", 300, 400, 250);
+    b.setPosition({350, 0, 100});
+    results.push_back(runMicro("Item::doesIntersect", 2000000 * scale, [&]() {
+        sink += a.doesIntersect(b);
+    }));
+
+    Bin trailer("Trailer", 2480, 2650, 13600);
+    results.push_back(runMicro("Bin::getBestRotationOrder", 200000 * scale, [&]() {
+        sink += trailer.getBestRotationOrder(a).size();
+    }));
+    results.push_back(runMicro("Bin::rankRotations", 2000000 * scale, [&]() {
+        sink += trailer.rankRotations(a).count;
+    }));
+
+    // A trailer filled with 500 mm cubes; probes land on occupied space
+    std::vector<Item> fillers;
+    fillers.reserve(4 * 5 * 27);
+    for (long x = 0; x + 500 <= 2480; x += 500) {
+        for (long y = 0; y + 500 <= 2650; y += 500) {
+            for (long z = 0; z + 500 <= 13600; z += 500) {
+                fillers.emplace_back("Filler", 500, 500, 500, std::vector<RotationType>{RotationType::whd});
+                trailer.putItem(fillers.back(), {x, y, z});
+            }
+        }
+    }
+    Item probe("Probe", 500, 500, 500);
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<long> px(0, 2000), py(0, 2000), pz(0, 13000);
+    results.push_back(runMicro("Bin::putItem (rejected, " + std::to_string(fillers.size()) + " placed)",
+                               200000 * scale, [&]() {
+        sink += trailer.putItem(probe, {px(rng), py(rng), pz(rng)});
+    }));
+
+    const auto packing = generateItems(300, 7);
+    results.push_back(runMicro("Packer::packToBin (300 items)", 5 * scale, [&]() {
+        Packer packer;
+        for (const auto& item : packing) {
+            packer.addItem(item);
+        }
+        Bin bin("Trailer", 2480, 2650, 13600);
+        std::vector<Item*> ptrs;
+        for (auto& item : packer.items) {
+            ptrs.push_back(&item);
+        }
+        sink += packer.packToBin(bin, ptrs).size();
+    }));
+    return results;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t max_items = 10000;
+    uint64_t seed = 42;
+    bool quick = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--max-items") == 0 && i + 1 < argc) {
+            max_items = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--max-items N] [--seed S] [--quick]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::cout << "{\n  \"overlap_kernel\": \"" << overlapKernelName() << "\",\n  \"micro\": [\n";
+    const auto micros = runMicros(quick ? 1 : 5);
+    for (size_t i = 0; i < micros.size(); ++i) {
+        std::cout << "    {\"name\": \"" << micros[i].name << "\", \"iterations\": " << micros[i].iterations
+                  << ", \"ns_per_op\": " << micros[i].ns_per_op << "}" << (i + 1 < micros.size() ? "," : "") << "\n";
+    }
+    std::cout << "  ],\n  \"scaling\": [\n";
+    bool first = true;
+    for (const auto& mix : binMixes()) {
+        for (size_t count = 100; count <= max_items; count *= 10) {
+            std::cout << (first ? "" : ",\n") << "    " << runScalingIsolated(mix, count, seed) << std::flush;
+            first = false;
+        }
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <array>
+
+// Axis-aligned box in bin coordinates, half-open on every axis: [min, max).
+struct Aabb {
+    std::array<long, 3> min;
+    std::array<long, 3> max;
+
+    bool overlaps(const Aabb& other) const {
+        return min[0] < other.max[0] && other.min[0] < max[0] &&
+               min[1] < other.max[1] && other.min[1] < max[1] &&
+               min[2] < other.max[2] && other.min[2] < max[2];
+    }
+
+    // Overlap of the x/z footprints only, ignoring height.
+    bool overlapsFootprint(const Aabb& other) const {
+        return min[0] < other.max[0] && other.min[0] < max[0] &&
+               min[2] < other.max[2] && other.min[2] < max[2];
+    }
+};
+
+#endif // AABB_H
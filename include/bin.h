@@ -2,32 +2,280 @@
 #include <vector>
 #include <string>
 #include <functional>  // Include for std::reference_wrapper
+#include <unordered_map>
+#include "aabb.h"
 #include "box.h"
+#include "height_map.h"
 #include "item.h"
+#include "item_arena.h"
+#include "pack_stats.h"
+#include "placed_boxes.h"
+#include "spatial_grid.h"
+
+// Allowed rotations of an item ranked by Bin::scoreRotation, best first.
+// Fixed-size so ranking on the placement path never touches the heap.
+struct RotationOrder {
+    std::array<RotationType, 6> rotations;
+    size_t count = 0;
+
+    const RotationType* begin() const { return rotations.data(); }
+    const RotationType* end() const { return rotations.data() + count; }
+    bool empty() const { return count == 0; }
+    RotationType operator[](size_t i) const { return rotations[i]; }
+};
+
+// A rectangular block of identical units: counts along x, y and z, all in
+// one rotation.
+struct BlockShape {
+    RotationType rotation = RotationType::whd;
+    std::array<long, 3> counts = {0, 0, 0};
+
+    size_t size() const { return static_cast<size_t>(counts[0] * counts[1] * counts[2]); }
+};
+
+// Running totals over a bin's placed items, updated with every placement.
+struct BinLoad {
+    double weight = 0;
+    double volume = 0;
+    std::array<double, 3> weight_moment = {0, 0, 0};  // sum of weight x centre, per axis
+    std::array<double, 3> volume_moment = {0, 0, 0};  // sum of volume x centre, per axis
+
+    void add(const Aabb& box, double item_weight);
+};
+
+// Region the loaded centre of gravity has to end up in, in bin coordinates.
+struct CogEnvelope {
+    bool enabled = false;
+    std::array<double, 3> min = {0, 0, 0};
+    std::array<double, 3> max = {0, 0, 0};
+
+    // Distance from the region, 0 inside it.
+    double gap(const std::array<double, 3>& point) const;
+};
+
+// A point in a bin's placement history, from Bin::mark().
+struct BinMark {
+    size_t items = 0;   // placements at the time of the mark
+    size_t points = 0;  // extreme-point journal length at the time of the mark
+    size_t depth = 0;   // marks open, this one included
+    uint64_t epoch = 0; // the bin's mark counter when this mark was opened
+    BinLoad load;       // totals at the time of the mark
+};
 
 class Bin : public Box {
 public:
-    Bin(const std::string& name, long w, long h, long d, float max_weight, const std::string& image, const std::string& description, int id);
+    Bin(const std::string& name, long w, long h, long d, float max_weight = 0.0f, const std::string& image = "", const std::string& description = "", int id = 0);
     
-    const std::vector<std::reference_wrapper<Item>>& getItems() const;
-    void setItems(const std::vector<std::reference_wrapper<Item>>& items);
+    // Placed items, resolved through the arena the bin is attached to. A bin
+    // used on its own keeps copies of the items put into it in an arena of
+    // its own, shared with its copies.
+    std::vector<std::reference_wrapper<Item>> getItems() const;
+    const std::vector<ItemHandle>& getItemHandles() const;
+    size_t itemCount() const;
+    // Throws std::logic_error for handles with no arena to resolve them in.
+    void setItems(const std::vector<ItemHandle>& items);
+    // Arena that item handles refer to; Packer attaches its bins to its own.
+    void attach(ItemArena* arena);
+    // Same, with the bin sharing ownership, so it can outlive the packer the
+    // items came from.
+    void attach(std::shared_ptr<ItemArena> arena);
 
+    // Whether the item in this rotation fits inside the empty bin.
+    bool fitsRotation(const Item& item, RotationType rotation) const;
+    // How snugly the rotation fills the bin, higher is better; 0 if it does
+    // not fit, but also for an item of zero size, so use fitsRotation to test.
     float scoreRotation(const Item& item, long rotationType) const;
+    RotationOrder rankRotations(const Item& item) const;
+    // Same as rankRotations(), as a vector for the Python binding.
     std::vector<long> getBestRotationOrder(const Item& item) const;
+    // Rotations putItem tries for this item, best first: allowed rotations
+    // that fit the bin, with rotations giving identical dimensions collapsed.
+    // Cached per item geometry, so scoring happens once per distinct item.
+    const RotationOrder& getRotationPlan(const Item& item) const;
+    // Places item at p in the first rotation that fits, then lets it drop
+    // straight down onto the highest surface beneath it.
     bool putItem(Item& item, const std::tuple<long, long, long>& p);
+    // Online placement: putItem at each extreme point in order until one
+    // takes the item. Each point keeps a bound on the free space around it,
+    // and the bin one over all its points, so points and bins with too
+    // little room are passed over without a collision query. Bounds only
+    // loosen, never go wrong, while items are just added; removing any
+    // drops them.
+    bool putItemFirstFit(Item& item);
+    // Share of a placed item's base resting on the floor or on other items.
+    double supportRatio(const Item& item) const;
+
+    // Load totals, kept up to date on every placement rather than recounted.
+    double getLoadWeight() const { return load.weight; }
+    double getLoadVolume() const { return load.volume; }
+    double getFillRatio() const;
+    // Weighted by item weight, or by volume while nothing placed has weight.
+    // The bin's floor centre while empty.
+    std::array<double, 3> getCentreOfGravity() const;
+    // Share of the load weight on each axle of axle_z, by the lever rule on
+    // the centre of gravity's depth.
+    std::array<double, 2> getAxleLoads() const;
+
+    // Largest block of at most `limit` units of item's type that fits at p,
+    // over every rotation of the plan. Blocks grow across the width first,
+    // then upwards, then backwards, so they build walls. Size 0 if not even
+    // one unit fits.
+    BlockShape findBlock(const Item& item, const std::tuple<long, long, long>& p, size_t limit) const;
+    // Places units[0 .. shape.size()) as a block found by findBlock at p,
+    // dropped onto the surface beneath it like a single item.
+    void placeBlock(Item* const* units, const std::tuple<long, long, long>& p, const BlockShape& shape);
 
     // Add new method for gravity-assisted placement
     bool putItemWithGravity(Item& item, const std::tuple<long, long, long>& p);
 
+    // Undo for backtracking search: mark() opens a mark, rollback(mark)
+    // removes every placement made since and restores the extreme points,
+    // commit(mark) keeps them. Both close the mark and any opened after it,
+    // and throw std::logic_error for a mark that is already closed.
+    // Cost is proportional to the changes since the mark, not to the bin.
+    // setItems() discards all open marks.
+    BinMark mark();
+    void rollback(const BinMark& mark);
+    void commit(const BinMark& mark);
+
+    // Records `item` by its handle (Item::input_index) without any checks.
     void addItem(Item& item);
 
+    // Candidate positions for the next item, ordered back to front (z), then
+    // bottom to top (y), then left to right (x).
+    const std::vector<std::tuple<long, long, long>>& getExtremePoints() const;
+
     std::string toString() const;
     
     int id;
+    // Heaviest load the bin takes; 0 means no limit.
     float max_weight;
+    // Where the two axles carrying the bin sit along its depth; a negative
+    // value stands for the far end.
+    std::array<float, 2> axle_z = {0.0f, -1.0f};
+    // When enabled, a placement that would leave the centre of gravity
+    // outside the envelope must not move it further away; loading can still
+    // start anywhere and work towards it.
+    CogEnvelope cog_envelope;
+    // Smallest share of an item's base that must rest on the floor or on
+    // other items; 0 accepts any overhang.
+    float min_support = 0.0f;
     std::string image;
     std::string description;
-    std::vector<std::reference_wrapper<Item>> items;
+    std::vector<ItemHandle> items;
 
 private:
+    struct PlanKey {
+        long width, height, depth;
+        unsigned allowed;  // bit per RotationType
+        bool operator==(const PlanKey& other) const {
+            return width == other.width && height == other.height &&
+                   depth == other.depth && allowed == other.allowed;
+        }
+    };
+    struct PointHash {
+        size_t operator()(const std::tuple<long, long, long>& p) const {
+            size_t h = std::hash<long>()(std::get<0>(p));
+            h = h * 31 + std::hash<long>()(std::get<1>(p));
+            return h * 31 + std::hash<long>()(std::get<2>(p));
+        }
+    };
+    struct PlanKeyHash {
+        size_t operator()(const PlanKey& key) const {
+            size_t h = std::hash<long>()(key.width);
+            h = h * 31 + std::hash<long>()(key.height);
+            h = h * 31 + std::hash<long>()(key.depth);
+            return h * 31 + key.allowed;
+        }
+    };
+
+    // Outcome of checking one rotation at one position, in check order.
+    enum class Fit { out_of_bounds, disable_stacking, overlap, bottom_load_only, unsupported, off_balance, fits };
+    Fit checkFit(const Item& item, const Aabb& box) const;
+    // Checks box where it comes to rest, lowering box.min/max[1] onto it.
+    Fit checkRest(const Item& item, Aabb& box) const;
+    // Whether a block of units of size d at `block` passes checkRest, with
+    // every unit of its bottom layer supported.
+    bool blockRests(const Item& item, const Aabb& block, const Dimension& d) const;
+    // Whether adding `weight` at box keeps to cog_envelope.
+    bool keepsBalance(const Aabb& box, double weight) const;
+    Aabb boxFor(const Item& item) const;
+    void indexBox(const Aabb& box, bool disable_stacking, float weight);
+    void insertBox(const Aabb& box, bool disable_stacking, float weight);
+    void rebuildIndex();
+    bool collides(const Aabb& box) const;
+    // Like collides, also handing back the placed box nearest box.min among
+    // those it overlaps.
+    bool collidesWith(const Aabb& box, Aabb& hit) const;
+    // Far end of the free space when `base` (itself free) is stretched along
+    // `axis` up to `limit`.
+    long freeRun(const Aabb& base, size_t axis, long limit) const;
+    bool isOccupied(const std::array<long, 3>& point) const;
+    long project(const std::array<long, 3>& point, size_t axis) const;
+    void updateExtremePoints(const Aabb& placed);
+    void insertPoint(const std::tuple<long, long, long>& point);
+    void erasePoint(const std::tuple<long, long, long>& point);
+    void removeLastBox();
+    // Free run from p along each axis, 0 if p is occupied.
+    std::array<long, 3> roomAt(const std::tuple<long, long, long>& p) const;
+    void dropRoom();
+    bool isOpen(const BinMark& mark) const;
+    void closeMark(const BinMark& mark);
+
+    // Handle under which item is recorded: its input_index in the packer's
+    // arena, or that of a copy added to the bin's own.
+    ItemHandle handleFor(const Item& item);
+
+    ItemArena* arena = nullptr;
+    std::shared_ptr<ItemArena> own_items;  // set when `arena` is the bin's own
+
+    // Collision index over `items`: placed boxes in insertion order, stored as
+    // structure-of-arrays next to `items`, plus a grid of buckets so putItem
+    // only looks at items near the candidate position.
+    PlacedBoxes boxes;
+    SpatialGrid index;
+    HeightMap heights;  // top surfaces over the floor, for gravity and support
+    mutable std::vector<uint32_t> candidates;  // scratch for grid query results
+    size_t stacking_blocked = 0;  // placed items with disable_stacking set
+    BinLoad load;
+
+    mutable std::unordered_map<PlanKey, RotationOrder, PlanKeyHash> rotation_plans;
+    mutable std::array<long, 3> plan_extent = {-1, -1, -1};  // bin size the plans were made for
+
+    // Extreme points: corners of placed items projected onto the walls or the
+    // nearest item below/behind/left. Occupied and duplicate points are pruned.
+    // There is no dominance pruning: a point nearer the origin need not take
+    // every box a farther one does, since the gap between them may be
+    // blocked, so no free point is safe to drop.
+    std::vector<std::tuple<long, long, long>> extreme_points = {{0, 0, 0}};
+
+    // Extreme points added (true) or removed (false) while a mark is open
+    std::vector<std::pair<std::tuple<long, long, long>, bool>> point_journal;
+    // Epochs of the open marks, outermost first; a mark is open while its
+    // epoch is still at its depth
+    std::vector<uint64_t> open_marks;
+    uint64_t mark_epoch = 0;
+
+    // What putItemFirstFit knows about the space at one extreme point. Free
+    // space only shrinks while items are added, so once a placed box starts
+    // `blocked` away from the point on every axis, any size reaching past it
+    // on every axis collides there for good.
+    struct PointRoom {
+        std::array<long, 3> room = {0, 0, 0};  // free run along each axis
+        std::array<Dimension, 4> blocked;      // smallest colliding sizes, newest overwriting oldest
+        uint8_t blocked_count = 0;
+        uint8_t blocked_next = 0;
+        uint64_t generation = 0;  // room_generation it was computed under
+
+        bool admits(const Dimension& d) const;
+        void block(const Dimension& d);
+    };
+
+    // Room for putItemFirstFit: per extreme point, and the largest per axis
+    // over all points as of the last scan that found no place
+    std::unordered_map<std::tuple<long, long, long>, PointRoom, PointHash> point_room;
+    std::array<long, 3> room_bound = {0, 0, 0};
+    bool room_bound_valid = false;
+    // Bumped when a rollback removes boxes; entries from older generations are stale
+    uint64_t room_generation = 0;
 };
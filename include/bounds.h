@@ -0,0 +1,33 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <cstddef>
+#include <vector>
+#include "bin.h"
+#include "item.h"
+
+// Lower bounds on the number of bins an order needs, from dimensions and
+// weights alone. Bins of different sizes are bounded through one bin as
+// large as the largest along each axis, so every bound holds for any mix.
+// Items are grouped by ItemType first: the cost is O(n) plus O(t log t) in
+// the number of distinct types t.
+struct BinBounds {
+    size_t volume = 0;  // total volume over the largest bin volume
+    size_t weight = 0;  // total weight over the largest max_weight; 0 if a bin has no limit
+    // Martello-Pisinger-Vigo L1: items too large in two axes to stand side
+    // by side must be stacked along the third, a 1D bin packing problem.
+    size_t l1 = 0;
+    // Martello-Pisinger-Vigo L2: L1 plus the volume those items leave
+    // unusable for items that cannot sit beside them.
+    size_t l2 = 0;
+    size_t unfit = 0;  // items no bin can take (fitsAnyBin), left out of the bounds
+
+    size_t lower() const;
+};
+
+// Whether item fits inside at least one of the bins in an allowed rotation,
+// within that bin's max_weight.
+bool fitsAnyBin(const Item& item, const std::vector<Bin>& bins);
+BinBounds computeBounds(const std::vector<const Item*>& items, const std::vector<Bin>& bins);
+
+#endif // BOUNDS_H
@@ -0,0 +1,61 @@
+#ifndef HEIGHT_MAP_H
+#define HEIGHT_MAP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "aabb.h"
+
+// 2.5D view of a bin from above: a grid of cells over the x/z floor, each
+// holding the footprints of the boxes standing on it and the highest top
+// among them. Queries only look at the cells under a footprint, so they cost
+// in proportion to the footprint, not to the number of placed boxes. Answers
+// are exact: cells narrow the search, footprints decide.
+class HeightMap {
+public:
+    // Resize the grid for a bin floor of the given size and drop all boxes.
+    void reset(long width, long depth);
+    void clear();
+    bool covers(long width, long depth) const {
+        return extent_[0] == width && extent_[1] == depth;
+    }
+    void insert(const Aabb& box, bool disable_stacking);
+    // Drops the most recently inserted box. Costs the occupancy of its cells.
+    void removeLast();
+    size_t size() const { return bottom_.size(); }
+
+    // Highest top at or below `y` under box's footprint, 0 for the floor. A
+    // box that fits at `y` can drop to this height without hitting anything.
+    long restingHeight(const Aabb& box, long y) const;
+    // Share of box's footprint resting on the floor or on tops at box.min[1].
+    double supportedFraction(const Aabb& box) const;
+    // Whether some box under the footprint starts below `y`.
+    bool anyBelow(const Aabb& box, long y) const;
+    // Whether some disable_stacking box over the footprint starts above `y`.
+    bool stackingBlockedAbove(const Aabb& box, long y) const;
+
+private:
+    struct Cell {
+        long top = 0;                // highest top of any box touching the cell
+        long lowest_bottom = -1;     // -1 while the cell is empty
+        long highest_blocked = -1;   // highest bottom of a disable_stacking box
+        std::vector<uint32_t> ids;
+    };
+
+    bool cellRange(const Aabb& box, std::array<long, 2>& lo, std::array<long, 2>& hi) const;
+    size_t cellOf(long x, long z) const;
+    bool overlapsFootprint(uint32_t id, const Aabb& box) const;
+
+    std::array<long, 2> extent_ = {-1, -1};
+    std::array<long, 2> cell_size_ = {1, 1};
+    std::array<long, 2> cell_count_ = {0, 0};
+    std::vector<Cell> cells_;
+
+    // Footprints as structure-of-arrays, indexed by insertion order
+    std::vector<long> min_x_, max_x_, min_z_, max_z_;
+    std::vector<long> bottom_, top_;
+    std::vector<uint8_t> disable_stacking_;
+};
+
+#endif // HEIGHT_MAP_H
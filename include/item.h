@@ -1,11 +1,14 @@
 // item.h
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <ostream>
-#include "box.h"
+#include "aabb.h"
 
 enum class RotationType {
     whd,
@@ -31,6 +34,13 @@ const std::map<RotationType, std::string> ROTATION_TYPE_STRINGS = {
     {RotationType::wdh, "(w, d, h)"}
 };
 
+// Bits of the per-item flag byte used by the bulk (array) APIs.
+constexpr uint8_t ITEM_BOTTOM_LOAD_ONLY = 1 << 0;
+constexpr uint8_t ITEM_DISABLE_STACKING = 1 << 1;
+
+// Width, height and depth of an item as placed, without heap allocation.
+using Dimension = std::array<long, 3>;
+
 inline size_t axisToIndex(Axis axis) {
     switch (axis) {
         case Axis::width: return 0;
@@ -40,7 +50,34 @@ inline size_t axisToIndex(Axis axis) {
     }
 }
 
-class Item : public Box {
+// What every unit of one SKU shares: identity, geometry, allowed rotations
+// and handling data. Items point at a type, so a thousand identical parcels
+// store this once; Packer merges equal types, so name and colour are kept
+// once per SKU.
+struct ItemType {
+    std::string name;
+    std::string color;
+    long width;
+    long height;
+    long depth;
+    std::vector<RotationType> allowed_rotations;
+    float weight = 0.0f;
+    int stuffing_height = 0;
+    float stuffing_max_weight = 0.0f;
+    int stuffing_layers = 0;
+    bool bottom_load_only = false;
+    bool disable_stacking = false;
+
+    bool operator==(const ItemType& other) const;
+};
+
+struct ItemTypeHash {
+    size_t operator()(const ItemType& type) const;
+};
+
+// One unit: its type, plus the position and rotation it was packed with.
+// Setters on type data copy the type first if other items share it.
+class Item {
 public:
     // Single constructor with default arguments
     Item(const std::string& name, 
@@ -55,6 +92,38 @@ public:
          int stuffing_layers = 0,
          bool bottom_load_only = false,
          bool disable_stacking = false);
+    // A unit of an existing type.
+    explicit Item(std::shared_ptr<const ItemType> type);
+
+    const ItemType& getType() const { return *type; }
+    const std::shared_ptr<const ItemType>& getSharedType() const { return type; }
+    void setType(std::shared_ptr<const ItemType> type);
+
+    std::string getName() const { return type->name; }
+    long getWidth() const { return type->width; }
+    long getHeight() const { return type->height; }
+    long getDepth() const { return type->depth; }
+    long getVolume() const { return type->width * type->height * type->depth; }
+    const std::string& getColor() const { return type->color; }
+    float getWeight() const { return type->weight; }
+    int getStuffingHeight() const { return type->stuffing_height; }
+    float getStuffingMaxWeight() const { return type->stuffing_max_weight; }
+    int getStuffingLayers() const { return type->stuffing_layers; }
+    bool bottomLoadOnly() const { return type->bottom_load_only; }
+    bool disablesStacking() const { return type->disable_stacking; }
+
+    void setName(const std::string& name);
+    void setWidth(long width);
+    void setHeight(long height);
+    void setDepth(long depth);
+    void setColor(const std::string& color);
+    void setWeight(float weight);
+    void setStuffingHeight(int stuffing_height);
+    void setStuffingMaxWeight(float stuffing_max_weight);
+    void setStuffingLayers(int stuffing_layers);
+    void setBottomLoadOnly(bool bottom_load_only);
+    void setDisableStacking(bool disable_stacking);
+    void setAllowedRotations(const std::vector<RotationType>& rotations);
 
     const std::vector<RotationType>& getAllowedRotations() const;
     RotationType getRotationType() const;
@@ -64,26 +133,29 @@ public:
     void setPosition(const std::tuple<long, long, long>& position);
 
     std::string getRotationTypeString() const;
+    Dimension getDims() const;
+    Dimension getDims(RotationType rotation) const;
+    // Same as getDims(), as a vector for the Python binding.
     std::vector<long> getDimension() const;
     std::vector<long> getPos() const;
+    // Occupied region at the current position and rotation.
+    Aabb getBounds() const;
 
     bool doesIntersect(const Item& other) const;
 
     bool operator==(const Item& other) const;
 
     friend std::ostream& operator<<(std::ostream& os, const Item& item);
-    std::vector<RotationType> _allowed_rotations;
     std::tuple<long, long, long> _position;
     RotationType _rotation_type;
-    std::string color;
-    float weight;
-    int stuffing_height;
-    float stuffing_max_weight;
-    int stuffing_layers;
-    bool bottom_load_only;
-    bool disable_stacking;
+    // Position in the packer's input order, set by Packer::addItem/addItems.
+    // Also the item's handle in the packer's ItemArena.
+    uint32_t input_index = 0;
 
 private:
+    ItemType& mutableType();
+
+    std::shared_ptr<const ItemType> type;
 };
 
 bool rectIntersect(const Item& item1, const Item& item2, Axis x, Axis y);
@@ -0,0 +1,92 @@
+#ifndef ITEM_ARENA_H
+#define ITEM_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <vector>
+#include "item.h"
+
+// Index of an item in its packer's ItemArena. Bins store these instead of
+// references, so a placement costs 4 bytes and survives copies of the packer.
+using ItemHandle = uint32_t;
+
+// Item storage in fixed-size chunks. Items never move once added, so handles
+// and pointers stay valid while the arena grows. clear() only resets the
+// count: the chunks stay allocated and their slots stay constructed, so later
+// adds assign into existing items instead of allocating chunks again.
+class ItemArena {
+public:
+    template <bool Const>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Item;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const Item*, Item*>;
+        using reference = std::conditional_t<Const, const Item&, Item&>;
+        using Arena = std::conditional_t<Const, const ItemArena, ItemArena>;
+
+        Iterator(Arena* arena, ItemHandle handle) : arena(arena), handle(handle) {}
+        reference operator*() const { return (*arena)[handle]; }
+        pointer operator->() const { return &(*arena)[handle]; }
+        Iterator& operator++() { ++handle; return *this; }
+        Iterator operator++(int) { Iterator old = *this; ++handle; return old; }
+        bool operator==(const Iterator& other) const { return handle == other.handle; }
+        bool operator!=(const Iterator& other) const { return handle != other.handle; }
+
+    private:
+        Arena* arena;
+        ItemHandle handle;
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    ItemArena() = default;
+    ItemArena(const ItemArena& other);
+    ItemArena(ItemArena&& other) noexcept;
+    ItemArena& operator=(const ItemArena& other);
+    ItemArena& operator=(ItemArena&& other) noexcept;
+    ~ItemArena();
+
+    ItemHandle add(const Item& item);
+    ItemHandle add(Item&& item);
+
+    Item& operator[](ItemHandle handle) { return *slot(handle); }
+    const Item& operator[](ItemHandle handle) const { return *slot(handle); }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void reserve(size_t capacity);
+    // Drops every item in O(1); see the class comment.
+    void clear() { count = 0; }
+
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, static_cast<ItemHandle>(count)}; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, static_cast<ItemHandle>(count)}; }
+
+private:
+    static constexpr size_t CHUNK_BITS = 8;
+    static constexpr size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+
+    struct Chunk {
+        alignas(Item) unsigned char storage[sizeof(Item) * CHUNK_SIZE];
+    };
+
+    Item* slot(size_t index) const {
+        auto* base = reinterpret_cast<Item*>(chunks[index >> CHUNK_BITS]->storage);
+        return std::launder(base + (index & (CHUNK_SIZE - 1)));
+    }
+    template <typename T>
+    ItemHandle emplace(T&& item);
+    void destroy();
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    size_t count = 0;        // live items
+    size_t constructed = 0;  // slots holding an Item, live or kept for reuse
+};
+
+#endif // ITEM_ARENA_H
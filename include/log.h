@@ -1,11 +1,110 @@
 #ifndef LOG_H
 #define LOG_H
 
-#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
 
-extern bool is_log_enabled;
+enum class LogLevel : uint8_t {
+    debug,
+    info,
+    warn,
+    error
+};
 
+// Calls below this level compile to nothing. Debug calls sit on the placement
+// hot path, so they are only built in with -DLOG_MIN_LEVEL=0.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 1
+#endif
+
+// One key=value pair of a log record. Keys and string values are stored as
+// pointers, so they must be string literals (or otherwise outlive the writer).
+struct LogField {
+    enum class Type : uint8_t { integer, real, text };
+
+    const char* key = "";
+    Type type = Type::integer;
+    union {
+        int64_t integer;
+        double real;
+        const char* text;
+    } value = {0};
+
+    LogField() = default;
+    template <typename T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>, int> = 0>
+    LogField(const char* key, T v) : key(key), type(Type::integer) { value.integer = static_cast<int64_t>(v); }
+    template <typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+    LogField(const char* key, T v) : key(key), type(Type::real) { value.real = v; }
+    LogField(const char* key, const char* v) : key(key), type(Type::text) { value.text = v; }
+};
+
+constexpr size_t LOG_MAX_FIELDS = 6;
+
+// Fixed-size record; nothing is formatted or allocated by the logging thread.
+struct LogRecord {
+    uint64_t timestamp_ns = 0;
+    LogLevel level = LogLevel::debug;
+    uint8_t field_count = 0;
+    uint32_t thread = 0;    // registration order of the logging thread
+    uint64_t sequence = 0;  // position in that thread's stream
+    const char* ns = "";
+    const char* event = "";
+    LogField fields[LOG_MAX_FIELDS];
+};
+
+extern std::atomic<bool> is_log_enabled;
+
+// Runtime switch, off by default. Records are queued on a per-thread ring and
+// written by a background thread.
 void enable_log(bool enable);
-void log(const std::string& ns, const std::string& message);
+// Output stream for the writer thread, stdout by default.
+void set_log_output(std::FILE* out);
+// Writes every record queued so far before returning.
+void flush_log();
+// Records dropped because a thread's ring was full.
+uint64_t dropped_log_records();
+
+void submit_log(const LogRecord& record);
+
+template <LogLevel Level, typename... Fields>
+inline void log_at(const char* ns, const char* event, const Fields&... fields) {
+    static_assert(sizeof...(Fields) <= LOG_MAX_FIELDS, "too many log fields");
+    if constexpr (static_cast<int>(Level) >= LOG_MIN_LEVEL) {
+        if (!is_log_enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        LogRecord record;
+        record.level = Level;
+        record.ns = ns;
+        record.event = event;
+        record.field_count = static_cast<uint8_t>(sizeof...(Fields));
+        [[maybe_unused]] size_t i = 0;
+        ((record.fields[i++] = LogField(fields)), ...);
+        submit_log(record);
+    }
+}
+
+// log_debug("packer", "unfit", LogField("item", index), LogField("volume", v))
+template <typename... Fields>
+inline void log_debug(const char* ns, const char* event, const Fields&... fields) {
+    log_at<LogLevel::debug>(ns, event, fields...);
+}
+
+template <typename... Fields>
+inline void log_info(const char* ns, const char* event, const Fields&... fields) {
+    log_at<LogLevel::info>(ns, event, fields...);
+}
+
+template <typename... Fields>
+inline void log_warn(const char* ns, const char* event, const Fields&... fields) {
+    log_at<LogLevel::warn>(ns, event, fields...);
+}
+
+template <typename... Fields>
+inline void log_error(const char* ns, const char* event, const Fields&... fields) {
+    log_at<LogLevel::error>(ns, event, fields...);
+}
 
 #endif // LOG_H
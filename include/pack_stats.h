@@ -0,0 +1,77 @@
+#ifndef PACK_STATS_H
+#define PACK_STATS_H
+
+#include <cstdint>
+
+// Counters and phase timings for one Packer::pack() call. Always compiled in:
+// counting is a thread-local pointer check plus a plain increment, so it can
+// stay on in production.
+struct PackStats {
+    // Bin::putItem outcomes. Every rejected attempt has exactly one reason: the
+    // furthest check any rotation got to.
+    uint64_t put_attempts = 0;
+    uint64_t put_accepted = 0;
+    uint64_t rejected_out_of_bounds = 0;     // outside the bin in every fitting rotation
+    uint64_t rejected_bottom_load_only = 0;  // bottom_load_only item that would not reach the floor
+    uint64_t rejected_disable_stacking = 0;  // would stack on or under a disable_stacking item
+    uint64_t rejected_overlap = 0;           // collides with a placed item
+    uint64_t rejected_unsupported = 0;       // would rest on less than Bin::min_support of its base
+    uint64_t rejected_overweight = 0;        // would take the bin over Bin::max_weight
+    uint64_t rejected_off_balance = 0;       // would move the centre of gravity further outside Bin::cog_envelope
+
+    // Where packToBin took its candidate positions from.
+    uint64_t candidates_start = 0;          // bin origin, for the first item of a bin
+    uint64_t candidates_extreme_point = 0;  // the bin's extreme points
+
+    uint64_t blocks_placed = 0;  // multi-unit blocks placed by block building
+    uint64_t block_units = 0;    // units placed inside those blocks
+
+    uint64_t bins_tried = 0;   // bins probed while choosing where to start
+    uint64_t bin_trials = 0;   // trial packs run by best_fill / fewest_leftovers
+    uint64_t packs_run = 0;    // greedy passes, more than one in portfolio mode
+    uint64_t prefiltered_unfit = 0;  // units set aside up front: they fit no bin in any rotation
+
+    // Improvement phase: moves tried, moves kept, and new best solutions.
+    uint64_t improve_moves = 0;
+    uint64_t improve_accepted = 0;
+    uint64_t improve_best = 0;
+
+    double seconds_ordering = 0;
+    double seconds_bin_selection = 0;
+    double seconds_packing = 0;
+    double seconds_improving = 0;
+    double seconds_total = 0;
+
+    void merge(const PackStats& other);
+};
+
+// Stats block that counters on this thread currently go to, or null.
+inline PackStats*& currentPackStats() {
+    thread_local PackStats* current = nullptr;
+    return current;
+}
+
+// Routes this thread's counters to `stats` for the lifetime of the scope.
+class PackStatsScope {
+public:
+    explicit PackStatsScope(PackStats* stats) : previous(currentPackStats()) {
+        currentPackStats() = stats;
+    }
+    ~PackStatsScope() {
+        currentPackStats() = previous;
+    }
+    PackStatsScope(const PackStatsScope&) = delete;
+    PackStatsScope& operator=(const PackStatsScope&) = delete;
+
+private:
+    PackStats* previous;
+};
+
+// Bumps a counter of the current stats block, if any.
+inline void countStat(uint64_t PackStats::*counter, uint64_t amount = 1) {
+    if (PackStats* stats = currentPackStats()) {
+        stats->*counter += amount;
+    }
+}
+
+#endif // PACK_STATS_H
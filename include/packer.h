@@ -1,29 +1,254 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <optional>
+#include <tuple>
+#include <unordered_map>
 #include <functional>  // Include for std::reference_wrapper
 #include "bin.h"
+#include "bounds.h"
 #include "item.h"
+#include "pack_stats.h"
+
+class ThreadPool;
+
+// How the packer picks the next bin to open.
+enum class BinSelection {
+    first_fit,        // first bin (smallest volume first) that accepts the item
+    best_fill,        // candidate whose trial pack reaches the highest fill ratio
+    fewest_leftovers  // candidate whose trial pack leaves the fewest items out
+};
+
+// Order in which the greedy pass takes items, largest first.
+enum class ItemOrdering {
+    volume,
+    longest_edge,
+    base_area,  // width x depth footprint
+    weight,
+    random      // volume order with seeded local swaps
+};
+
+// What makes one complete packing better than another in portfolio mode.
+enum class PackObjective {
+    packed_volume,  // most volume packed, then fewest bins
+    fewest_bins,    // fewest unfit items, then fewest bins, then most volume
+    fill_ratio      // highest packed volume / volume of the bins used
+};
+
+// Stop flag for a running pack. Copies share one flag, so the caller keeps a
+// copy and cancels it from any thread while pack() runs with another.
+class CancelToken {
+public:
+    CancelToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+    void cancel() const { flag->store(true, std::memory_order_relaxed); }
+    bool cancelled() const {
+        return flag->load(std::memory_order_relaxed) || (parent && parent->cancelled());
+    }
+    // A new token that is also cancelled once this one is, while cancelling
+    // it leaves this one alone. For stopping one call without touching the
+    // token the caller passed in.
+    CancelToken linked() const {
+        CancelToken token;
+        token.parent = std::make_shared<const CancelToken>(*this);
+        return token;
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+    std::shared_ptr<const CancelToken> parent;
+};
+
+// How the improvement phase decides whether to move to a worse solution.
+enum class SearchAcceptance {
+    late_acceptance,     // no worse than the solution of a fixed number of steps ago
+    simulated_annealing  // worse by d with probability exp(-d / T), T cooling over the budget
+};
+
+struct PackOptions {
+    BinSelection bin_selection = BinSelection::first_fit;
+    // Worker threads for trial packs and portfolio runs; 0 means one per hardware thread
+    // and 1 runs trial packs inline. Portfolio runs and packMany use 1 inside their workers.
+    size_t threads = 0;
+
+    ItemOrdering ordering = ItemOrdering::volume;
+    uint64_t seed = 0;
+
+    // Portfolio mode: when either field is set, pack() runs one greedy pass per
+    // listed ordering plus random_starts seeded random orderings, each on its
+    // own clone of the problem, and keeps the best by `objective`.
+    std::vector<ItemOrdering> portfolio;
+    size_t random_starts = 0;
+    PackObjective objective = PackObjective::packed_volume;
+
+    // Place runs of identical units as whole k x m x n blocks where they fit,
+    // before falling back to one unit at a time.
+    bool block_building = true;
+
+    // Improvement phase after the greedy pass: local search over the item
+    // sequence and the order bins are opened in, replaying the greedy packer
+    // for every move and keeping the best result by `objective`. Runs until
+    // either budget is spent; both 0 (the default) skips it.
+    double improve_seconds = 0;
+    size_t improve_iterations = 0;
+    SearchAcceptance acceptance = SearchAcceptance::late_acceptance;
+
+    // Latency bound: the greedy pass checks both between items and between
+    // candidate positions. Once either trips, the items not yet placed are
+    // reported unfit and Packer::truncated() is set. The improvement phase
+    // ends at the same point but never truncates the result.
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    // Seconds from the start of pack(); 0 means none. Turned into a deadline
+    // when the pack starts, and the earlier of the two wins.
+    double time_limit = 0;
+    CancelToken cancel_token;
+};
+
+// Where Packer::place put an item.
+struct Placement {
+    ItemHandle item = 0;  // the item's handle in getItems()
+    int32_t bin = -1;     // index into getBins(), -1 if no bin took it
+    std::tuple<long, long, long> position = {0, 0, 0};
+    RotationType rotation = RotationType::whd;
+    bool opened_bin = false;  // the item was the first into its bin
+
+    bool placed() const { return bin >= 0; }
+};
 
 class Packer {
 public:
     Packer();
+    // Copies and moves re-attach the bins to this packer's own arena.
+    Packer(const Packer& other);
+    Packer(Packer&& other) noexcept;
+    Packer& operator=(const Packer& other);
+    Packer& operator=(Packer&& other) noexcept;
     
     const std::vector<Bin>& getBins() const;
-    const std::vector<Item>& getItems() const;
-    const std::vector<Item>& getUnfitItems() const;
+    const ItemArena& getItems() const;
+    std::vector<std::reference_wrapper<const Item>> getUnfitItems() const;
 
     void addBin(const Bin& bin);
+    void addBin(Bin&& bin);
+    // Items with equal type data share one ItemType, however they are added.
     void addItem(const Item& item);
+    void addItem(Item&& item);
+    // Adds `quantity` units of one SKU and returns its index in getItemTypes().
+    // flags holds ITEM_* bits; no rotations means all six.
+    uint32_t addItemType(const Dimension& dims, const std::vector<RotationType>& rotations = {},
+                         uint8_t flags = 0, float weight = 0.0f, size_t quantity = 1,
+                         const std::string& name = "", const std::string& color = "#000000");
+    const std::vector<std::shared_ptr<const ItemType>>& getItemTypes() const;
+    // Bulk input: count items from contiguous arrays. dims holds count rows of
+    // (w, h, d). weights, flags (ITEM_* bits) and rotation_masks (bit per
+    // RotationType, 0 = all) may be null.
+    void addItems(size_t count, const int64_t* dims, const float* weights = nullptr,
+                  const uint8_t* flags = nullptr, const uint8_t* rotation_masks = nullptr);
+    // Bulk output, one row per item in input order: index into getBins() or -1
+    // if unpacked, position (x, y, z), rotation and packed (w, h, d). Rows of
+    // unpacked items are -1 then all zeros.
+    void writePlacements(int32_t* bin_index, int64_t* position, uint8_t* rotation, int64_t* packed_dims) const;
     std::optional<std::reference_wrapper<Bin>> findFittedBin(Item& item);
     std::optional<std::reference_wrapper<Bin>> getBiggerBinThan(const Bin& other_bin);
     void unfitItem(std::vector<Item*>& item_ptrs);
     std::vector<Item*> packToBin(Bin& bin, std::vector<Item*>& item_ptrs);
     void pack();
-    std::vector<Item> items;
+    void pack(const PackOptions& options);
+    // Online packing, for items that arrive one at a time: adds item and
+    // places it for good in the first open bin (one holding items, in
+    // getBins() order) that has room, at the first of its extreme points
+    // that takes it. Failing that and with open_bin set, the first empty bin
+    // that takes the item is opened; otherwise the item is recorded unfit.
+    // Nothing is sorted or repacked and earlier placements never move, so
+    // the cost follows the open bins' extreme points, not the items placed.
+    // Stats add up in stats() until the next pack() or reset().
+    Placement place(const Item& item, bool open_bin = true);
+    // Counters and timings of the last pack() call. Portfolio runs report the
+    // sum over every run; seconds_total is always wall time.
+    const PackStats& stats() const;
+    // Whether the last pack() stopped early on its deadline or cancel token.
+    bool truncated() const;
+    // Lower bounds on the bins this order needs, from dimensions and weights
+    // alone: a quote that only needs a bin count can skip pack() entirely.
+    BinBounds bounds() const;
+
+    // Copy of the bins and items with all packing state cleared, sharing
+    // nothing with this packer, so it can be packed on another thread.
+    Packer cloneProblem() const;
+    // Drops all items and placements but keeps the bins and every buffer, so
+    // a long-lived worker can pack order after order without reallocating.
+    // The cost does not depend on how many items were packed.
+    void reset();
+    ItemArena items;
     std::vector<Bin> bins;
-    std::vector<Item> unfit_items;
+    std::vector<ItemHandle> unfit_items;
+    std::vector<std::shared_ptr<const ItemType>> item_types;
 
 private:
+    // Replays cached results in place of pack()
+    friend class ResultCache;
+
+    struct TypeKeyHash {
+        size_t operator()(const ItemType* type) const { return ItemTypeHash()(*type); }
+    };
+    struct TypeKeyEqual {
+        bool operator()(const ItemType* a, const ItemType* b) const { return *a == *b; }
+    };
+
+    struct BinTrial {
+        long packed_volume = 0;
+        size_t leftovers = 0;
+        PackStats stats;  // counted on the worker, merged by the caller
+    };
+
+    bool orderedBefore(const Item& a, const Item& b) const;
+    void orderItems(std::vector<Item*>& item_ptrs) const;
+    void attachBins();
+    uint32_t internType(Item& item);
+    void packGreedy();
+    // Greedy pass over items in the given order and bins in their current order.
+    void packSequence(std::vector<Item*> item_ptrs);
+    void improve();
+    // Scalar form of `objective` for the improvement phase; lower is better.
+    double searchCost(PackObjective objective) const;
+    void packPortfolio(const PackOptions& pack_options);
+    bool betterThan(const Packer& other, PackObjective objective) const;
+    // Whether no packing can beat this one: every item that fits a bin is
+    // packed, in no more bins than the lower bound.
+    bool reachesBound() const;
+
+    std::vector<Bin*> binsAccepting(Item& item);
+    std::vector<Bin*> binsBiggerThan(const Bin& other_bin);
+    BinTrial trialPack(Bin& bin, std::vector<Item>& scratch_items) const;
+    std::optional<std::reference_wrapper<Bin>> selectBin(const std::vector<Bin*>& candidates,
+                                                         const std::vector<Item*>& item_ptrs);
+
+    PackOptions options;
+    PackStats pack_stats;
+    // Index into item_types by type content; keys point into item_types.
+    std::unordered_map<const ItemType*, uint32_t, TypeKeyHash, TypeKeyEqual> type_index;
+    ThreadPool* pool = nullptr;  // only set while pack() runs a selection mode on several threads
+    bool fixed_sequence = false;  // packToBin keeps the caller's item order
+    bool pack_truncated = false;
+
+    // Set once the deadline or cancel token trips during a pack
+    bool outOfTime();
+    bool stopped = false;
+    uint32_t stop_checks = 0;
+    // bounds() for reachesBound(), worked out on first use after pack()
+    // starts, so packs that never stop early do not pay for it
+    const BinBounds& packBounds() const;
+    mutable std::optional<BinBounds> pack_bounds;
 };
+
+// A copy of options with time_limit turned into a deadline counted from
+// start. Its time_limit is cleared, so packs nested inside keep the same clock.
+PackOptions startClock(const PackOptions& options, std::chrono::steady_clock::time_point start);
+
+// Packs independent problems concurrently on a work-stealing pool and returns
+// once all are done. Each packer must appear once; 0 threads means one per
+// hardware thread.
+void packMany(const std::vector<Packer*>& packers, const PackOptions& options = PackOptions{}, size_t threads = 0);
@@ -1,10 +1,14 @@
 #ifndef PALLET_H
 #define PALLET_H
 
+#include <map>
 #include <vector>
 #include <string>
 #include "item.h"
 
+// A pallet and the load on it. Items are placed relative to the deck: their
+// position is measured from the deck's near corner, y = 0 being the top of
+// the boards, and the load height is the highest item top above the floor.
 class Pallet {
 public:
     Pallet(double length, double width, double thickness, double max_height, double max_weight);
@@ -22,8 +26,11 @@ public:
     const std::vector<Item*>& getItems() const;
     
     // Operations
+    // Whether item, at its current position and rotation, stays on the deck,
+    // under max height and within the weight left.
     bool canAddItem(const Item& item) const;
     bool addItem(Item* item);
+    // O(log n) height update: tops are counted per height, not rescanned.
     void removeItem(Item* item);
     
     // Utility
@@ -32,6 +39,9 @@ public:
     bool isWithinBaseArea(const Item& item) const;
 
 private:
+    // Height of item's top above the deck.
+    static double topOf(const Item& item);
+
     double length_;
     double width_;
     double thickness_;
@@ -40,6 +50,8 @@ private:
     double current_height_;
     double current_weight_;
     std::vector<Item*> items_;
+    std::vector<double> item_tops_;  // top of each item when it was added
+    std::map<double, size_t> tops_;  // item count per top height
 };
 
-#endif // PALLET_H
\ No newline at end of file
+#endif // PALLET_H
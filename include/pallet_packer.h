@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "bin.h"
+#include "item.h"
+#include "packer.h"
+#include "pallet.h"
+
+// Two-stage loading, the way docks do it: cartons are first built into
+// pallet loads, then the finished pallets are loaded into the containers as
+// rigid boxes. Pallets are independent of each other, so stage one packs them
+// in parallel, and each subproblem is the size of one pallet, not of the
+// whole order.
+class PalletPacker {
+public:
+    // Every pallet load is built on a copy of `pallet`, which should be empty.
+    // Its length, width and thickness are rounded up to whole units.
+    explicit PalletPacker(const Pallet& pallet);
+    // Pallets point into the carton arena, so a copy would share them.
+    PalletPacker(const PalletPacker&) = delete;
+    PalletPacker& operator=(const PalletPacker&) = delete;
+    PalletPacker(PalletPacker&&) = default;
+    PalletPacker& operator=(PalletPacker&&) = default;
+
+    void addBin(const Bin& container);
+    void addItem(const Item& carton);
+    // Both stages use `options`; stage one runs one pack per pallet on
+    // options.threads workers.
+    void pack(const PackOptions& options = PackOptions{});
+
+    // Cartons in input order, positioned relative to their pallet's deck.
+    const ItemArena& getItems() const;
+    // Loads built in stage one; their items point into getItems().
+    const std::vector<Pallet>& getPallets() const;
+    // Index into getPallets() of the pallet a carton went on, -1 if none.
+    int32_t palletOf(ItemHandle carton) const;
+    // Stage two: item i stands for pallet i, packed into the containers.
+    const Packer& getContainers() const;
+    // Cartons on no pallet, or on a pallet no container took.
+    std::vector<std::reference_wrapper<const Item>> getUnfitItems() const;
+    // Same layout as Packer::writePlacements, with every carton placed in
+    // container coordinates.
+    void writePlacements(int32_t* bin_index, int64_t* position, uint8_t* rotation, int64_t* packed_dims) const;
+    // Whether either stage stopped early on the deadline or cancel token.
+    bool truncated() const;
+
+    // Stage one deals cartons out to pallets in order until a pallet's share
+    // reaches this fraction of its usable volume; what does not fit is dealt
+    // again in the next round.
+    double fill_target = 0.9;
+    // Let pallets go on top of other pallets in the containers.
+    bool stack_pallets = false;
+
+private:
+    void buildPallets(const PackOptions& options);
+    void loadContainers(const PackOptions& options);
+    // Whether carton fits an empty pallet in any of its rotations.
+    bool fitsPallet(const Item& carton) const;
+    // Container each pallet went in, -1 if none.
+    std::vector<int32_t> palletBins() const;
+
+    Pallet pallet_type;
+    Packer cartons;     // only its arena is used: stable carton storage
+    Packer containers;  // stage two
+    std::vector<Pallet> pallets;
+    std::vector<int32_t> carton_pallet;  // by carton handle
+    bool pack_truncated = false;
+};
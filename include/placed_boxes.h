@@ -0,0 +1,48 @@
+#ifndef PLACED_BOXES_H
+#define PLACED_BOXES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "aabb.h"
+
+// Structure-of-arrays store of the min/max corners of the items placed in a
+// bin, in placement order. Coordinates are kept as 64-bit integers so the
+// overlap kernels are exact.
+class PlacedBoxes {
+public:
+    void push_back(const Aabb& box, bool disable_stacking);
+    void clear();
+    // Drops the most recently added box.
+    void pop_back();
+    size_t size() const { return min_x.size(); }
+    bool empty() const { return min_x.empty(); }
+
+    Aabb operator[](size_t i) const {
+        return {{static_cast<long>(min_x[i]), static_cast<long>(min_y[i]), static_cast<long>(min_z[i])},
+                {static_cast<long>(max_x[i]), static_cast<long>(max_y[i]), static_cast<long>(max_z[i])}};
+    }
+    bool disablesStacking(size_t i) const { return disable_stacking[i] != 0; }
+
+    // True if `box` overlaps any stored box.
+    bool anyOverlap(const Aabb& box) const;
+    // True if `box` overlaps any of the stored boxes listed in ids[0..count).
+    bool anyOverlap(const Aabb& box, const uint32_t* ids, size_t count) const;
+
+    std::vector<int64_t> min_x, min_y, min_z;
+    std::vector<int64_t> max_x, max_y, max_z;
+    std::vector<uint8_t> disable_stacking;
+};
+
+// Name of the overlap kernel picked for this CPU ("avx2", "sse4.2" or "scalar").
+const char* overlapKernelName();
+// Every kernel this CPU can run, the picked one first and "scalar" last.
+std::vector<std::string> overlapKernelNames();
+// anyOverlap through the named kernel, so tests can check the kernels agree:
+// over ids[0..count), or every stored box when ids is null. Throws
+// std::invalid_argument for a kernel not in overlapKernelNames().
+bool anyOverlapWithKernel(const std::string& kernel, const PlacedBoxes& boxes, const Aabb& box,
+                          const uint32_t* ids = nullptr, size_t count = 0);
+
+#endif // PLACED_BOXES_H
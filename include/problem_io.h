@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include "packer.h"
+
+// JSON form of a packing problem and its result, one object per line, for
+// batch runs from the command line (pack_cli.cpp).
+//
+// Problem:
+//   {"id": "order-17",
+//    "bins": [{"name": "Truck", "size": [w, h, d], "max_weight": 500,
+//              "min_support": 0.8, "count": 2}],
+//    "items": [{"name": "A", "size": [w, h, d], "weight": 1.5, "quantity": 3,
+//               "rotations": [0, 3], "bottom_load_only": false,
+//               "disable_stacking": false}],
+//    "options": {"bin_selection": "first_fit", "ordering": "volume",
+//                "seed": 0, "portfolio": ["volume", "weight"],
+//                "random_starts": 0, "objective": "packed_volume",
+//                "block_building": true, "improve_seconds": 0,
+//                "improve_iterations": 0, "acceptance": "late_acceptance",
+//                "time_limit": 2.5}}
+// Only "size" is required. Rotations are RotationType values; none means all
+// six. Unknown keys are ignored.
+//
+// Result:
+//   {"id": "order-17", "line": 1, "bins": [{"name": "Truck", "size": [w, h, d],
+//    "items": [{"item": 0, "position": [x, y, z], "rotation": 3,
+//               "size": [w, h, d]}]}],
+//    "unfit": [4, 5], "truncated": false, "seconds": 0.012}
+// "item" and "unfit" index the units in input order, each quantity expanded.
+// Only bins that received items are listed.
+struct PackRequest {
+    std::string id;  // the "id" value as JSON text, echoed back; empty if absent
+    Packer packer;
+    PackOptions options;
+};
+
+// Throws std::invalid_argument naming what is wrong with the line.
+PackRequest parsePackRequest(const std::string& line);
+// One line of JSON, without the newline, for a packed request.
+std::string formatPackResult(const PackRequest& request, size_t line, double seconds);
+std::string formatPackError(const std::string& id, size_t line, const std::string& message);
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "packer.h"
+
+// 128-bit digest of a packing problem.
+struct ProblemHash {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    bool operator==(const ProblemHash& other) const { return high == other.high && low == other.low; }
+    bool operator!=(const ProblemHash& other) const { return !(*this == other); }
+};
+
+struct ProblemHashHasher {
+    size_t operator()(const ProblemHash& hash) const { return static_cast<size_t>(hash.low); }
+};
+
+// Canonical hash of a packer's problem: the multiset of bin specs and of item
+// geometries, allowed rotations, flags and weights. Insertion order, names,
+// colours and placements do not count, so two quotes for the same order hash
+// alike however they were entered. Stable across processes and runs.
+ProblemHash problemHash(const Packer& packer);
+// problemHash combined with the options that change the result; threads,
+// deadline and cancel token are left out.
+ProblemHash problemHash(const Packer& packer, const PackOptions& options);
+
+// Results of earlier packs, keyed on problemHash, for repeated quotes. A hit
+// replays the stored placements onto the caller's own items and bins, matched
+// up by their canonical order: units that only differ by name or colour are
+// interchangeable. Entries live in memory, least recently used evicted first,
+// and optionally in a memory-mapped file that outlives the process.
+// Truncated packs are never stored. All members are thread safe.
+class ResultCache {
+public:
+    // max_bytes bounds the entries held in memory.
+    explicit ResultCache(size_t max_bytes = 64u << 20);
+    ~ResultCache();
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Also keeps results in the file at path, created or grown to file_bytes
+    // as needed, and loads the results already in it. Once the file is full
+    // it starts over empty. One process at a time may use a file. Returns
+    // false, and stays memory only, if the file cannot be mapped.
+    bool openFile(const std::string& path, size_t file_bytes = 256u << 20);
+    void closeFile();
+
+    // Fills packer from a stored result for its problem under options, or
+    // packs it and stores the result. Returns whether it was a hit.
+    bool pack(Packer& packer, const PackOptions& options = PackOptions{});
+
+    size_t hits() const;
+    size_t misses() const;
+    size_t size() const;   // entries in memory
+    size_t bytes() const;  // memory held by those entries
+    void clear();          // memory only; the file keeps its entries
+
+private:
+    struct Entry {
+        ProblemHash key;
+        std::vector<uint8_t> result;
+    };
+
+    // Lays a stored result out on packer's items and bins, given both in
+    // canonical order. False, with packer untouched, if it does not decode
+    // to a complete placement of this problem.
+    static bool replay(Packer& packer, const std::vector<ItemHandle>& item_order,
+                       const std::vector<uint32_t>& bin_order, const std::vector<uint8_t>& stored);
+    // Copies out the result for key from memory, else from the file, which
+    // brings it back into memory. Caller holds the lock.
+    bool find(const ProblemHash& key, std::vector<uint8_t>& result);
+    // Caller holds the lock
+    void remember(const ProblemHash& key, std::vector<uint8_t> result);
+    void evict();
+    void storeOnDisk(const ProblemHash& key, const std::vector<uint8_t>& result);
+    void loadFileIndex();
+
+    size_t max_bytes;
+    size_t used_bytes = 0;
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+    std::list<Entry> entries;  // most recently used first
+    std::unordered_map<ProblemHash, std::list<Entry>::iterator, ProblemHashHasher> lookup;
+
+    // Memory-mapped file: a header, then records appended one after another
+    int file = -1;
+    uint8_t* mapped = nullptr;
+    size_t mapped_bytes = 0;
+    std::unordered_map<ProblemHash, size_t, ProblemHashHasher> file_index;  // record offsets
+
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,70 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "aabb.h"
+
+// Uniform 3D grid of buckets over a bin. Every placed box is registered in
+// each cell it touches, so a query only visits boxes near the query region.
+class SpatialGrid {
+public:
+    // Resize the grid for a bin of the given dimensions and drop all entries.
+    void reset(long width, long height, long depth);
+    void clear();
+    bool covers(long width, long height, long depth) const {
+        return extent_[0] == width && extent_[1] == height && extent_[2] == depth;
+    }
+    void insert(uint32_t id, const Aabb& box);
+    // Unregisters the most recently inserted box; `box` must be the one it was
+    // inserted with.
+    void removeLast(uint32_t id, const Aabb& box);
+    size_t size() const { return count_; }
+
+    // Calls visit(id) once for every box registered in a cell touched by
+    // region. Stops and returns true as soon as visit returns true.
+    template <typename Visitor>
+    bool query(const Aabb& region, Visitor&& visit) const;
+
+private:
+    bool cellRange(const Aabb& box, std::array<long, 3>& lo, std::array<long, 3>& hi) const;
+
+    std::array<long, 3> extent_ = {-1, -1, -1};
+    std::array<long, 3> cell_size_ = {1, 1, 1};
+    std::array<long, 3> cell_count_ = {0, 0, 0};
+    std::vector<std::vector<uint32_t>> cells_;
+    size_t count_ = 0;
+
+    // Per-id visit stamps so a box spanning several cells is reported once.
+    mutable std::vector<uint32_t> stamps_;
+    mutable uint32_t epoch_ = 0;
+};
+
+template <typename Visitor>
+bool SpatialGrid::query(const Aabb& region, Visitor&& visit) const {
+    std::array<long, 3> lo, hi;
+    if (!cellRange(region, lo, hi)) {
+        return false;
+    }
+    if (++epoch_ == 0) {
+        std::fill(stamps_.begin(), stamps_.end(), 0);
+        epoch_ = 1;
+    }
+    for (long cy = lo[1]; cy <= hi[1]; ++cy) {
+        for (long cz = lo[2]; cz <= hi[2]; ++cz) {
+            for (long cx = lo[0]; cx <= hi[0]; ++cx) {
+                const auto& cell = cells_[(cy * cell_count_[2] + cz) * cell_count_[0] + cx];
+                for (uint32_t id : cell) {
+                    if (stamps_[id] == epoch_) continue;
+                    stamps_[id] = epoch_;
+                    if (visit(id)) return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+#endif // SPATIAL_GRID_H
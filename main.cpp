@@ -1,10 +1,63 @@
 #include "packer.h"
+#include "pallet_packer.h"
+#include "problem_io.h"
+#include "result_cache.h"
+#include "thread_pool.h"
 #include "bin.h"
 #include "item.h"
+#include "log.h"
+#include "placed_boxes.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
 #include <iostream>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
-void runTest(const std::string& testName, const std::vector<Bin>& bins, const std::vector<Item>& items, const std::function<bool(const Packer&)>& expectation) {
+// Counts heap allocations so tests can check the placement path for churn.
+// Every form of new and delete is replaced, so each pointer is freed by the
+// allocator it came from.
+static size_t allocation_count = 0;
+
+static void* countedAlloc(std::size_t size) {
+    ++allocation_count;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) {
+    return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void runTest(const std::string& testName, const std::vector<Bin>& bins, const std::vector<Item>& items, const std::function<bool(const Packer&)>& expectation, const PackOptions& options = PackOptions{}) {
     Packer packer;
     for (const auto& bin : bins) {
         packer.addBin(bin);
@@ -12,7 +65,7 @@ void runTest(const std::string& testName, const std::vector<Bin>& bins, const st
     for (const auto& item : items) {
         packer.addItem(item);
     }
-    packer.pack();
+    packer.pack(options);
     if (expectation(packer)) {
         std::cout << testName << ": PASSED" << std::endl;
     } else {
@@ -20,7 +73,76 @@ void runTest(const std::string& testName, const std::vector<Bin>& bins, const st
     }
 }
 
-long main() {
+// Rejected placement attempts must not allocate, for both the linear sweep
+// (few items) and the grid lookup (many items).
+void runAllocationTest(const std::string& testName, long cube, long item_size) {
+    Bin bin("Alloc box", cube, cube, cube);
+    std::vector<Item> placed;
+    const long per_axis = cube / item_size;
+    placed.reserve(per_axis * per_axis * per_axis);
+    for (long x = 0; x < per_axis; ++x) {
+        for (long y = 0; y < per_axis; ++y) {
+            for (long z = 0; z < per_axis; ++z) {
+                placed.emplace_back("Filler", item_size, item_size, item_size);
+                bin.putItem(placed.back(), {x * item_size, y * item_size, z * item_size});
+            }
+        }
+    }
+    Item probe("Probe", item_size, item_size, item_size);
+    bin.putItem(probe, {0, 0, 0});  // warm up scratch buffers
+
+    const size_t before = allocation_count;
+    size_t attempts = 0;
+    for (long x = 0; x < cube; x += item_size / 2) {
+        for (long z = 0; z < cube; z += item_size / 2) {
+            bin.putItem(probe, {x, 0, z});
+            ++attempts;
+        }
+    }
+    const size_t allocations = allocation_count - before;
+    if (allocations == 0 && bin.itemCount() == placed.size()) {
+        std::cout << testName << ": PASSED" << std::endl;
+    } else {
+        std::cout << testName << ": FAILED (" << allocations << " allocations in " << attempts << " attempts)" << std::endl;
+    }
+}
+
+// Accepted placements allocate only the first time they touch a grid cell
+// or grow a container. Once a bin has been filled and rolled back, filling
+// it the same way again must not allocate at all.
+void runAcceptAllocationTest(const std::string& testName, long cube, long item_size) {
+    Packer packer;
+    packer.addBin(Bin("Alloc box", cube, cube, cube));
+    const long per_axis = cube / item_size;
+    const int count = static_cast<int>(per_axis * per_axis * per_axis);
+    packer.addItemType({item_size, item_size, item_size}, {}, 0, 0.0f, count, "Filler");
+    Bin& bin = packer.bins[0];
+    auto fill = [&]() {
+        ItemHandle next = 0;
+        for (long x = 0; x < per_axis; ++x) {
+            for (long y = 0; y < per_axis; ++y) {
+                for (long z = 0; z < per_axis; ++z) {
+                    bin.putItem(packer.items[next++], {x * item_size, y * item_size, z * item_size});
+                }
+            }
+        }
+    };
+    const BinMark empty = bin.mark();
+    fill();
+    bin.rollback(empty);
+    bin.mark();
+
+    const size_t before = allocation_count;
+    fill();
+    const size_t allocations = allocation_count - before;
+    if (allocations == 0 && bin.itemCount() == static_cast<size_t>(count)) {
+        std::cout << testName << ": PASSED" << std::endl;
+    } else {
+        std::cout << testName << ": FAILED (" << allocations << " allocations in " << count << " placements)" << std::endl;
+    }
+}
+
+int main() {
     std::vector<std::tuple<std::string, std::vector<Bin>, std::vector<Item>, std::function<bool(const Packer&)>>> testDatas = {
         {
             "Edge case that needs rotation.",
@@ -31,13 +153,13 @@ long main() {
         {
             "Edge case with only rotation 3 and 0 enabled.",
             { Bin("Le grande box", 100, 100, 300) },
-            { Item("Item 1", 150, 50, 50, {RotationType::whd, RotationType::hwd}, "red") },
+            { Item("Item 1", 150, 50, 50, {RotationType::whd, RotationType::dhw}, "red") },
             [](const Packer& packer) { return packer.getBins()[0].getItems().size() == 1 && packer.getUnfitItems().empty(); }
         },
         {
             "Test three items fit into smaller bin after being rotated.",
             { Bin("1. Le petite box", 296, 296, 8), Bin("2. Le grande box", 2960, 2960, 80) },
-            { Item("Item 1", 250, 250, 2, {RotationType::whd}, "red"), Item("Item 2", 250, 2, 250, {RotationType::whd}, "blue"), Item("Item 3", 2, 250, 250, {RotationType::whd}, "green") },
+            { Item("Item 1", 250, 250, 2, {}, "red"), Item("Item 2", 250, 2, 250, {}, "blue"), Item("Item 3", 2, 250, 250, {}, "green") },
             [](const Packer& packer) {
                 return packer.getBins()[0].getName() == "1. Le petite box" &&
                        packer.getBins()[0].getItems().size() == 3 &&
@@ -73,11 +195,17 @@ long main() {
             { Bin("Small Bin", 50, 100, 100), Bin("Bigger Bin", 150, 100, 100), Bin("Small Bin", 50, 100, 100) },
             { Item("Item 1 Small", 50, 100, 100, {RotationType::whd}, "red"), Item("Item 3 Small", 50, 100, 100, {RotationType::whd}, "blue"), Item("Item 3 Small", 50, 100, 100, {RotationType::whd}, "green"), Item("Item 2 Big", 100, 100, 100, {RotationType::whd}, "yellow") },
             [](const Packer& packer) {
-                return packer.getBins()[1].getName() == "Bigger Bin" &&
-                       packer.getBins()[1].getItems().size() == 2 &&
-                       packer.getBins()[0].getName() == "Small Bin" &&
-                       packer.getBins()[0].getItems().size() == 1 &&
-                       packer.getUnfitItems().empty();
+                // Bins are tried smallest first, so look them up by name
+                bool ok = packer.getUnfitItems().empty();
+                for (const auto& bin : packer.getBins()) {
+                    const auto items = bin.getItems();
+                    if (bin.getName() == "Bigger Bin") {
+                        ok = ok && items.size() == 2 && items[0].get().getName() == "Item 2 Big";
+                    } else {
+                        ok = ok && items.size() == 1;
+                    }
+                }
+                return ok;
             }
         },
         {
@@ -91,6 +219,24 @@ long main() {
             { Bin("Bin 1", 12, 12, 5.5) },
             { Item("Item 1", 12, 12, 0.005, {RotationType::whd}, "red"), Item("Item 2", 12, 12, 0.005, {RotationType::whd}, "blue") },
             [](const Packer& packer) { return packer.getBins()[0].getItems().size() == 2 && packer.getUnfitItems().empty(); }
+        },
+        {
+            "Zero-size items are packed, not unfit.",
+            { Bin("Bin 1", 10, 10, 10) },
+            { Item("Empty", 0, 0, 0), Item("Cube", 5, 5, 5) },
+            [](const Packer& packer) { return packer.getBins()[0].getItems().size() == 2 && packer.getUnfitItems().empty(); }
+        },
+        {
+            "Second best rotation is used when the best one does not fit the gap.",
+            { Bin("Bin 1", 100, 100, 100) },
+            { Item("Item 1", 100, 100, 60, {RotationType::whd}, "red"), Item("Item 2", 40, 100, 100, {RotationType::whd, RotationType::dhw}, "blue") },
+            [](const Packer& packer) { return packer.getBins()[0].getItems().size() == 2 && packer.getUnfitItems().empty(); }
+        },
+        {
+            "Rotations of a cube collapse to a single plan entry.",
+            { Bin("Bin 1", 2000, 2000, 2000) },
+            { Item("Cube", 1000, 1000, 1000) },
+            [](const Packer& packer) { return packer.getBins()[0].getRotationPlan(packer.getItems()[0]).count == 1; }
         }
     };
 
@@ -98,5 +244,613 @@ long main() {
         runTest(name, bins, items, expectation);
     }
 
+    PackOptions fewest_leftovers;
+    fewest_leftovers.bin_selection = BinSelection::fewest_leftovers;
+    fewest_leftovers.threads = 2;
+    runTest("Trial packs pick the bin that takes every item.",
+            { Bin("Small", 100, 100, 100), Bin("Large", 100, 100, 150) },
+            { Item("Item 1", 100, 100, 75, {RotationType::whd}, "red"), Item("Item 2", 100, 100, 75, {RotationType::whd}, "blue") },
+            [](const Packer& packer) {
+                return packer.getBins()[0].getItems().empty() &&
+                       packer.getBins()[1].getItems().size() == 2 &&
+                       packer.getUnfitItems().empty();
+            },
+            fewest_leftovers);
+
+    // One thread runs the same trials inline instead of on a pool
+    PackOptions inline_trials = fewest_leftovers;
+    inline_trials.threads = 1;
+    runTest("Inline trial packs pick the same bin.",
+            { Bin("Small", 100, 100, 100), Bin("Large", 100, 100, 150) },
+            { Item("Item 1", 100, 100, 75, {RotationType::whd}, "red"), Item("Item 2", 100, 100, 75, {RotationType::whd}, "blue") },
+            [](const Packer& packer) {
+                return packer.getBins()[0].getItems().empty() &&
+                       packer.getBins()[1].getItems().size() == 2 &&
+                       packer.stats().bin_trials > 0;
+            },
+            inline_trials);
+
+    PackOptions portfolio;
+    portfolio.portfolio = {ItemOrdering::volume, ItemOrdering::longest_edge, ItemOrdering::base_area, ItemOrdering::weight};
+    portfolio.random_starts = 4;
+    portfolio.threads = 4;
+    runTest("Portfolio runs return a complete packing.",
+            { Bin("Bin 1", 220, 160, 100) },
+            { Item("Item 1", 20, 100, 30, {RotationType::whd}, "red"), Item("Item 2", 100, 20, 30, {RotationType::whd}, "blue"), Item("Item 3", 20, 100, 30, {RotationType::whd}, "green"), Item("Item 4", 100, 20, 30, {RotationType::whd}, "yellow"), Item("Item 5", 100, 20, 30, {RotationType::whd}, "purple"), Item("Item 6", 100, 100, 30, {RotationType::whd}, "orange"), Item("Item 7", 100, 100, 30, {RotationType::whd}, "pink") },
+            [](const Packer& packer) {
+                size_t placed = 0;
+                for (const auto& item : packer.getBins()[0].getItems()) {
+                    placed += &item.get() == &packer.getItems()[item.get().input_index];
+                }
+                return placed == 7 && packer.getUnfitItems().empty();
+            },
+            portfolio);
+
+    // Volume order leaves one item out; reordering finds room for all five
+    PackOptions improve;
+    improve.improve_iterations = 100;
+    runTest("Improvement phase keeps the best packing it finds.",
+            { Bin("Bin 1", 100, 100, 100) },
+            { Item("Item 1", 50, 80, 30, {RotationType::whd}), Item("Item 2", 20, 90, 100, {RotationType::whd}), Item("Item 3", 80, 90, 20, {RotationType::whd}), Item("Item 4", 70, 90, 40, {RotationType::whd}), Item("Item 5", 20, 10, 50, {RotationType::whd}) },
+            [](const Packer& packer) {
+                return packer.getUnfitItems().empty() && packer.getBins()[0].itemCount() == 5 &&
+                       packer.stats().improve_best > 0 && packer.stats().improve_moves <= 100;
+            },
+            improve);
+
+    std::vector<Packer> batch(8);
+    std::vector<Packer*> batch_ptrs;
+    for (auto& packer : batch) {
+        packer.addBin(Bin("Bin 1", 220, 160, 100));
+        for (int i = 0; i < 7; ++i) {
+            packer.addItem(Item("Item", 20 + 10 * i, 40, 30));
+        }
+        batch_ptrs.push_back(&packer);
+    }
+    packMany(batch_ptrs, PackOptions{}, 4);
+    bool batch_ok = true;
+    for (const auto& packer : batch) {
+        batch_ok = batch_ok && packer.getBins()[0].getItems().size() == 7 && packer.getUnfitItems().empty();
+    }
+    std::cout << "Batch packing packs every problem: " << (batch_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Idle workers sleep while the only job runs instead of polling for work
+    bool idle_ok = false;
+    {
+        ThreadPool idle_pool(4);
+        idle_pool.submit([]() {}).get();  // let every worker reach its wait
+        const std::clock_t cpu_before = std::clock();
+        idle_pool.submit([]() { std::this_thread::sleep_for(std::chrono::milliseconds(300)); }).get();
+        const double cpu_seconds = static_cast<double>(std::clock() - cpu_before) / CLOCKS_PER_SEC;
+        idle_ok = cpu_seconds < 0.1 && idle_pool.submit([]() { return 7; }).get() == 7;
+    }
+    std::cout << "Idle pool workers sleep: " << (idle_ok ? "PASSED" : "FAILED") << std::endl;
+
+    Packer bulk;
+    bulk.addBin(Bin("Bin 1", 100, 100, 100));
+    const int64_t bulk_dims[] = {50, 100, 100, 100, 100, 100, 50, 100, 100};
+    const uint8_t bulk_masks[] = {1, 1, 1};  // whd only
+    bulk.addItems(3, bulk_dims, nullptr, nullptr, bulk_masks);
+    bulk.pack();
+    int32_t bulk_bins[3];
+    int64_t bulk_pos[9], bulk_packed[9];
+    uint8_t bulk_rot[3];
+    std::fill(bulk_pos, bulk_pos + 9, 7);
+    std::fill(bulk_packed, bulk_packed + 9, 7);
+    std::fill(bulk_rot, bulk_rot + 3, 7);
+    bulk.writePlacements(bulk_bins, bulk_pos, bulk_rot, bulk_packed);
+    // The big middle row is packed first; the two halves no longer fit and
+    // their rows are zeroed, not left as they were
+    bool bulk_ok = bulk_bins[0] == -1 && bulk_bins[1] == 0 && bulk_bins[2] == -1 &&
+                   bulk_packed[3] == 100 && bulk_pos[3] == 0 && bulk_rot[1] == 0;
+    for (int row : {0, 2}) {
+        bulk_ok = bulk_ok && bulk_rot[row] == 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            bulk_ok = bulk_ok && bulk_pos[3 * row + axis] == 0 && bulk_packed[3 * row + axis] == 0;
+        }
+    }
+    std::cout << "Bulk placements are reported in input order: " << (bulk_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Units of one SKU share a type, and leftovers of a full bin are skipped
+    // without retrying every extreme point
+    Packer typed;
+    typed.addBin(Bin("Bin 1", 100, 100, 100));
+    typed.addItemType({50, 50, 50}, {}, 0, 0.0f, 10, "Cube");
+    typed.addItem(Item("Cube", 50, 50, 50));
+    typed.pack();
+    const auto& typed_stats = typed.stats();
+    bool typed_ok = typed.getItemTypes().size() == 1 && typed.getBins()[0].itemCount() == 8 &&
+                    typed.getUnfitItems().size() == 3 &&
+                    typed.getItems()[0].getSharedType() == typed.getItems()[10].getSharedType() &&
+                    typed_stats.put_attempts < 8 * 8;
+    std::cout << "Item types share data and skip repeated failures: " << (typed_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // A portfolio pack adopts a run's result but keeps the type table, so
+    // later units of the same SKU still merge into the existing type
+    Packer typed_portfolio;
+    typed_portfolio.addBin(Bin("Bin 1", 100, 100, 100));
+    typed_portfolio.addItemType({50, 50, 50}, {}, 0, 0.0f, 4, "Cube");
+    typed_portfolio.pack(portfolio);
+    bool typed_portfolio_ok = typed_portfolio.getItemTypes().size() == 1;
+    typed_portfolio.addItem(Item("Cube", 50, 50, 50));
+    typed_portfolio.addItemType({50, 50, 50}, {}, 0, 0.0f, 1, "Cube");
+    typed_portfolio_ok = typed_portfolio_ok && typed_portfolio.getItemTypes().size() == 1 &&
+                         typed_portfolio.getItems()[0].getSharedType() == typed_portfolio.getItems()[5].getSharedType();
+    std::cout << "Portfolio packs keep the item types: " << (typed_portfolio_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // A run of identical cartons goes in as blocks and still fills the bin
+    Packer walls;
+    walls.addBin(Bin("Bin 1", 200, 100, 100));
+    walls.addItemType({50, 50, 50}, {}, 0, 0.0f, 16, "Carton");
+    walls.pack();
+    bool walls_ok = walls.getBins()[0].itemCount() == 16 && walls.getUnfitItems().empty() &&
+                    walls.stats().blocks_placed > 0 && walls.stats().block_units >= 8;
+    std::cout << "Identical units are placed as blocks: " << (walls_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Items drop all the way onto the surface below them, and a ledge that
+    // would hang half off its support is refused
+    Packer drop;
+    drop.addBin(Bin("Bin 1", 100, 100, 100));
+    drop.addItem(Item("Base", 100, 40, 50, {RotationType::whd}));
+    drop.addItem(Item("Top", 50, 20, 50, {RotationType::whd}));
+    drop.addItem(Item("Ledge", 50, 20, 50, {RotationType::whd}));
+    Bin& drop_bin = drop.bins[0];
+    drop_bin.min_support = 0.6f;
+    bool drop_ok = drop_bin.putItem(drop.items[0], {0, 0, 0}) &&
+                   drop_bin.putItem(drop.items[1], {0, 70, 0}) &&
+                   std::get<1>(drop.items[1].getPosition()) == 40 &&
+                   drop_bin.supportRatio(drop.items[1]) == 1.0 &&
+                   !drop_bin.putItem(drop.items[2], {50, 70, 25});
+    drop_bin.min_support = 0.0f;
+    drop_ok = drop_ok && drop_bin.putItem(drop.items[2], {50, 70, 25}) &&
+              drop_bin.supportRatio(drop.items[2]) == 0.5;
+    std::cout << "Items rest on the surface below them: " << (drop_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // A pack past its deadline stops early with every item accounted for once,
+    // and a cancelled one places nothing
+    Packer late;
+    for (int b = 0; b < 4; ++b) {
+        late.addBin(Bin("Trailer", 2480, 2650, 13600));
+    }
+    for (int i = 0; i < 3000; ++i) {
+        late.addItem(Item("Parcel", 200 + 37 * (i % 13), 150 + 53 * (i % 7), 180 + 29 * (i % 11)));
+    }
+    Packer cancelled = late;
+    PackOptions deadline_options;
+    deadline_options.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(2);
+    deadline_options.improve_iterations = 10;
+    late.pack(deadline_options);
+    size_t accounted = late.getUnfitItems().size();
+    for (const auto& bin : late.getBins()) {
+        accounted += bin.itemCount();
+    }
+    PackOptions cancel_options;
+    cancel_options.cancel_token.cancel();
+    cancelled.pack(cancel_options);
+    bool deadline_ok = late.truncated() && accounted == 3000 && late.stats().improve_moves == 0 &&
+                       !late.getUnfitItems().empty() && late.stats().seconds_total < 0.5 &&
+                       cancelled.truncated() && cancelled.getUnfitItems().size() == 3000;
+    std::cout << "Deadline and cancellation stop the pack cleanly: " << (deadline_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // A time limit counts from each pack's start, so saved options can be
+    // reused; a linked token stops one call without cancelling the caller's
+    PackOptions limited;
+    limited.time_limit = 5;
+    const auto started_at = std::chrono::steady_clock::now();
+    const PackOptions started = startClock(limited, started_at);
+    CancelToken caller;
+    CancelToken call = caller.linked();
+    call.cancel();
+    bool limit_ok = started.deadline == started_at + std::chrono::seconds(5) && started.time_limit == 0 &&
+                    limited.deadline == std::chrono::steady_clock::time_point::max() &&
+                    call.cancelled() && !caller.cancelled();
+    CancelToken next_call = caller.linked();
+    caller.cancel();
+    limit_ok = limit_ok && next_call.cancelled();
+    std::cout << "Time limits start with the pack and linked tokens cancel one call: " << (limit_ok ? "PASSED" : "FAILED")
+              << std::endl;
+
+    // Cartons go onto pallets within their height and weight limits, and the
+    // pallets into the container, with no two cartons overlapping there
+    PalletPacker docks(Pallet(1200, 800, 150, 1800, 1000));
+    docks.addBin(Bin("Container", 2350, 2390, 12000));
+    for (int i = 0; i < 300; ++i) {
+        docks.addItem(Item("Carton", 400 - 100 * (i % 2), 300, 250, {}, "#000000", 10.0f));
+    }
+    docks.pack();
+    std::vector<int32_t> carton_bin(300);
+    std::vector<int64_t> carton_at(900), carton_dims(900);
+    std::vector<uint8_t> carton_turn(300);
+    docks.writePlacements(carton_bin.data(), carton_at.data(), carton_turn.data(), carton_dims.data());
+    bool pallets_ok = docks.getUnfitItems().empty() && docks.getPallets().size() >= 3;
+    for (const auto& pallet : docks.getPallets()) {
+        pallets_ok = pallets_ok && pallet.getCurrentWeight() <= 1000 && pallet.getCurrentHeight() <= 1800;
+    }
+    for (size_t a = 0; a < 300 && pallets_ok; ++a) {
+        pallets_ok = carton_bin[a] == 0 && carton_at[3 * a + 1] >= 150;
+        for (size_t b = 0; b < a && pallets_ok; ++b) {
+            bool apart = false;
+            for (size_t axis = 0; axis < 3; ++axis) {
+                apart = apart || carton_at[3 * a + axis] + carton_dims[3 * a + axis] <= carton_at[3 * b + axis] ||
+                        carton_at[3 * b + axis] + carton_dims[3 * b + axis] <= carton_at[3 * a + axis];
+            }
+            pallets_ok = apart;
+        }
+    }
+    Pallet emptied = docks.getPallets()[0];
+    for (Item* carton : std::vector<Item*>(emptied.getItems())) {
+        emptied.removeItem(carton);
+    }
+    pallets_ok = pallets_ok && emptied.getCurrentHeight() == 150 && emptied.getCurrentWeight() == 0;
+    std::cout << "Cartons are palletized, then pallets loaded: " << (pallets_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // A pallet off the integer grid is rounded the same way in both stages:
+    // every carton is reported inside the space its pallet takes, above the deck
+    PalletPacker odd_docks(Pallet(600.5, 400.5, 100.5, 900, 1000));
+    odd_docks.addBin(Bin("Container", 1300, 1000, 1300));
+    for (int i = 0; i < 24; ++i) {
+        odd_docks.addItem(Item("Carton", 200, 100, 150 + (i % 2) * 50, {}, "#000000", 5.0f));
+    }
+    odd_docks.pack();
+    std::vector<int32_t> odd_bin(24);
+    std::vector<int64_t> odd_at(72), odd_dims(72);
+    std::vector<uint8_t> odd_turn(24);
+    odd_docks.writePlacements(odd_bin.data(), odd_at.data(), odd_turn.data(), odd_dims.data());
+    bool odd_ok = odd_docks.getUnfitItems().empty() && odd_docks.getPallets()[0].getWidth() == 401;
+    for (size_t a = 0; a < 24 && odd_ok; ++a) {
+        const Item& unit = odd_docks.getContainers().getItems()[odd_docks.palletOf(a)];
+        const auto& [px, py, pz] = unit.getPosition();
+        const auto unit_dims = unit.getDims();
+        const std::array<long, 3> low = {px, py + 101, pz};
+        const std::array<long, 3> high = {px + unit_dims[0], py + unit_dims[1], pz + unit_dims[2]};
+        for (size_t axis = 0; axis < 3; ++axis) {
+            odd_ok = odd_ok && odd_at[3 * a + axis] >= low[axis] &&
+                     odd_at[3 * a + axis] + odd_dims[3 * a + axis] <= high[axis];
+        }
+    }
+    std::cout << "Pallet decks are rounded alike in both stages: " << (odd_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Cubes over half the bin each need their own bin, which volume alone
+    // misses; an item too long for any bin is set aside before packing, and
+    // a packing at the bound skips the improvement phase
+    Packer bounded;
+    for (int b = 0; b < 8; ++b) {
+        bounded.addBin(Bin("Bin", 100, 100, 100, 100.0f));
+    }
+    bounded.addItemType({60, 60, 60}, {}, 0, 30.0f, 7, "Cube");
+    bounded.addItem(Item("Pole", 200, 10, 10, {RotationType::whd}));
+    const BinBounds estimate = bounded.bounds();
+    PackOptions bounded_options;
+    bounded_options.improve_iterations = 1000;
+    bounded.pack(bounded_options);
+    size_t bounded_bins = 0;
+    for (const auto& bin : bounded.getBins()) {
+        bounded_bins += bin.itemCount() > 0 ? 1 : 0;
+    }
+    bool bounds_ok = estimate.volume == 2 && estimate.weight == 3 && estimate.l1 == 7 && estimate.l2 == 7 &&
+                     estimate.unfit == 1 && estimate.lower() == 7 && bounded_bins == 7 &&
+                     bounded.stats().prefiltered_unfit == 1 && bounded.stats().improve_moves == 0;
+    std::cout << "Lower bounds count bins without packing: " << (bounds_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Load totals follow every placement and rollback; max_weight caps the
+    // load, and the centre of gravity is never pushed further off its envelope
+    Packer heavy;
+    heavy.addBin(Bin("Bin", 100, 100, 100, 50.0f));
+    heavy.addItemType({20, 20, 20}, {}, 0, 10.0f, 10, "Crate");
+    heavy.pack();
+    const Bin& heavy_bin = heavy.getBins()[0];
+    bool load_ok = heavy_bin.itemCount() == 5 && heavy.getUnfitItems().size() == 5 &&
+                   heavy_bin.getLoadWeight() == 50 && heavy_bin.getLoadVolume() == 40000 &&
+                   heavy_bin.getFillRatio() == 0.04 && heavy.stats().rejected_overweight > 0;
+
+    Packer balance;
+    balance.addBin(Bin("Bin", 100, 100, 100));
+    balance.addItem(Item("Light", 20, 20, 20, {RotationType::whd}, "#000000", 10.0f));
+    balance.addItem(Item("Heavy", 20, 20, 20, {RotationType::whd}, "#000000", 30.0f));
+    Bin& balance_bin = balance.bins[0];
+    load_ok = load_ok && balance_bin.putItem(balance.items[0], {0, 0, 0});
+    const BinMark before_heavy = balance_bin.mark();
+    load_ok = load_ok && balance_bin.putItem(balance.items[1], {80, 0, 0});
+    const auto cog = balance_bin.getCentreOfGravity();
+    const auto axles = balance_bin.getAxleLoads();
+    load_ok = load_ok && cog[0] == 70 && cog[2] == 10 && axles[0] == 36 && axles[1] == 4;
+    balance_bin.rollback(before_heavy);
+    load_ok = load_ok && balance_bin.getLoadWeight() == 10 && balance_bin.getCentreOfGravity()[0] == 10;
+
+    balance_bin.setItems({});
+    balance_bin.cog_envelope = {true, {40, 0, 0}, {60, 100, 100}};
+    load_ok = load_ok && balance_bin.putItem(balance.items[0], {40, 0, 0}) &&
+              !balance_bin.putItem(balance.items[1], {0, 0, 0}) &&
+              !balance_bin.putItem(balance.items[1], {80, 0, 0}) &&
+              balance_bin.putItem(balance.items[1], {40, 0, 20});
+    std::cout << "Bins keep load totals and limits: " << (load_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // The same order entered in another sequence under other names is a
+    // cache hit, laid out on the caller's own items
+    auto quote = [](bool shuffled) {
+        Packer order;
+        order.addBin(Bin(shuffled ? "Van" : "Truck", 100, 60, 80, 500.0f));
+        order.addBin(Bin("Small", 40, 40, 40));
+        const Dimension sizes[3] = {{30, 20, 40}, {50, 30, 20}, {60, 60, 90}};
+        for (int i = 0; i < 9; ++i) {
+            const int k = shuffled ? 8 - i : i;
+            order.addItem(Item((shuffled ? "B" : "A") + std::to_string(k), sizes[k % 3][0], sizes[k % 3][1],
+                               sizes[k % 3][2], {}, "#000000", 10.0f));
+        }
+        return order;
+    };
+    // A directory of its own, so parallel or leftover runs never share the file
+    const std::filesystem::path cache_dir =
+        std::filesystem::temp_directory_path() /
+        ("bin_packer_test_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    std::filesystem::create_directories(cache_dir);
+    const std::string cache_path = (cache_dir / "results.cache").string();
+    Packer first = quote(false), second = quote(true), reloaded = quote(true);
+    PackOptions best_fill;
+    best_fill.bin_selection = BinSelection::best_fill;
+    ResultCache cache(1 << 20);
+    bool cache_ok = cache.openFile(cache_path, 1 << 16) && problemHash(first) == problemHash(second) &&
+                    problemHash(first, PackOptions{}) != problemHash(first, best_fill) &&
+                    !cache.pack(first) && cache.pack(second) && cache.hits() == 1 && cache.misses() == 1;
+    auto layout = [](const Packer& packer) {
+        std::vector<std::tuple<long, long, long, long, Dimension>> placed;
+        for (size_t b = 0; b < packer.bins.size(); ++b) {
+            for (const Item& item : packer.bins[b].getItems()) {
+                const auto& [x, y, z] = item.getPosition();
+                placed.emplace_back(static_cast<long>(b), x, y, z, item.getDims());
+            }
+        }
+        std::sort(placed.begin(), placed.end());
+        return std::make_pair(placed, packer.getUnfitItems().size());
+    };
+    cache_ok = cache_ok && layout(first) == layout(second) && second.bins[0].getItems()[0].get().getName()[0] == 'B';
+    // A fresh cache finds the result in the file
+    ResultCache restarted(1 << 20);
+    cache_ok = cache_ok && restarted.openFile(cache_path, 1 << 16) && restarted.pack(reloaded) && layout(reloaded) == layout(first);
+    restarted.closeFile();
+    cache.closeFile();
+    std::filesystem::remove_all(cache_dir);
+    std::cout << "Repeated quotes hit the result cache: " << (cache_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // A JSONL problem line parses into a packer and comes back as one result line
+    PackRequest request = parsePackRequest(
+        "{\"id\": \"q\\u00e9-1\", \"bins\": [{\"name\": \"Crate\", \"size\": [10, 10, 10], \"count\": 2}],"
+        " \"items\": [{\"size\": [10, 10, 6], \"quantity\": 3}, {\"size\": [20, 1, 1]}],"
+        " \"options\": {\"ordering\": \"weight\", \"time_limit\": 5}}");
+    bool io_ok = request.id == "\"q\\u00e9-1\"" && request.packer.bins.size() == 2 && request.packer.items.size() == 4 &&
+                 request.options.ordering == ItemOrdering::weight && request.options.time_limit == 5;
+    request.packer.pack(request.options);
+    const std::string result_line = formatPackResult(request, 1, 0.25);
+    io_ok = io_ok && result_line.rfind("{\"id\": \"q\\u00e9-1\", \"line\": 1, \"bins\": [{\"name\": \"Crate\"", 0) == 0 &&
+            request.packer.unfit_items.size() == 2 &&
+            result_line.find("], \"truncated\": false, \"seconds\": 0.250000}") != std::string::npos;
+    for (const char* bad : {"{\"bins\": []}", "{\"bins\": [], \"items\": [{\"size\": [1, 2]}]}", "[1, 2", "{} x",
+                            "{\"bins\": [], \"items\": [], \"options\": {\"ordering\": \"tallest\"}}"}) {
+        try {
+            parsePackRequest(bad);
+            io_ok = false;
+        } catch (const std::invalid_argument&) {
+        }
+    }
+    io_ok = io_ok && formatPackError("7", 3, "bad \"size\"") == "{\"id\": 7, \"line\": 3, \"error\": \"bad \\\"size\\\"\"}";
+    std::cout << "Problems round-trip through JSON lines: " << (io_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Items placed one at a time stay where they were put; a new bin opens
+    // only when the open ones are full, and not at all without open_bin
+    Packer online;
+    online.addBin(Bin("Bin 1", 20, 20, 20));
+    online.addBin(Bin("Bin 2", 20, 20, 20));
+    std::vector<Placement> placements;
+    bool online_ok = true;
+    for (int k = 0; k < 16; ++k) {
+        placements.push_back(online.place(Item("Cube", 10, 10, 10)));
+        for (const Placement& earlier : placements) {
+            online_ok = online_ok && online.getItems()[earlier.item].getPosition() == earlier.position;
+        }
+    }
+    for (int k = 0; k < 16; ++k) {
+        online_ok = online_ok && placements[k].bin == k / 8 && placements[k].opened_bin == (k % 8 == 0);
+    }
+    online_ok = online_ok && !online.place(Item("Cube", 10, 10, 10), false).placed() &&
+                online.getUnfitItems().size() == 1 && online.bins[0].itemCount() == 8 &&
+                online.bins[1].itemCount() == 8;
+    std::cout << "Online placements stay fixed: " << (online_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Every overlap kernel this CPU runs answers like the scalar one, across
+    // vector tails, touching faces and gathered id lists
+    std::mt19937 kernel_rng(3);
+    auto coordinate = [&](long limit) { return static_cast<long>(kernel_rng() % limit); };
+    size_t kernel_hits = 0, kernel_checks = 0, kernel_mismatches = 0;
+    for (int trial = 0; trial < 2000; ++trial) {
+        PlacedBoxes stored;
+        const size_t count = trial % 19;  // every tail length of the 4- and 2-wide kernels
+        for (size_t i = 0; i < count; ++i) {
+            const std::array<long, 3> at = {coordinate(12), coordinate(12), coordinate(12)};
+            stored.push_back({at, {at[0] + 1 + coordinate(5), at[1] + 1 + coordinate(5), at[2] + 1 + coordinate(5)}},
+                             false);
+        }
+        Aabb query;
+        if (count > 0 && trial % 3 == 0) {
+            // Flush against a stored box on one axis: touching is not overlapping
+            const Aabb other = stored[kernel_rng() % count];
+            const size_t axis = kernel_rng() % 3;
+            query = other;
+            query.min[axis] = other.max[axis];
+            query.max[axis] = other.max[axis] + 1 + coordinate(4);
+        } else {
+            const std::array<long, 3> at = {coordinate(14), coordinate(14), coordinate(14)};
+            query = {at, {at[0] + 1 + coordinate(6), at[1] + 1 + coordinate(6), at[2] + 1 + coordinate(6)}};
+        }
+        std::vector<uint32_t> ids;
+        for (size_t k = count ? kernel_rng() % (2 * count) : 0; k > 0; --k) {
+            ids.push_back(static_cast<uint32_t>(kernel_rng() % count));
+        }
+        const bool expected_range = anyOverlapWithKernel("scalar", stored, query);
+        const bool expected_gather = anyOverlapWithKernel("scalar", stored, query, ids.data(), ids.size());
+        kernel_hits += expected_range ? 1 : 0;
+        for (const auto& kernel : overlapKernelNames()) {
+            kernel_mismatches += anyOverlapWithKernel(kernel, stored, query) != expected_range ? 1 : 0;
+            kernel_mismatches +=
+                anyOverlapWithKernel(kernel, stored, query, ids.data(), ids.size()) != expected_gather ? 1 : 0;
+            kernel_checks += 2;
+        }
+    }
+    const bool kernels_ok = kernel_mismatches == 0 && kernel_hits > 200 && kernel_hits < 1800 &&
+                            overlapKernelNames().front() == overlapKernelName();
+    std::cout << "Overlap kernels agree with scalar (" << overlapKernelNames().size() << " kernels): "
+              << (kernels_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Each placement swallows the points it covers and adds its outer corners
+    // projected onto the walls or the items behind, below or to the left
+    using Point = std::tuple<long, long, long>;
+    Bin corners("Corners", 100, 100, 100);
+    Item corner_a("A", 50, 50, 50), corner_b("B", 50, 50, 50), corner_c("C", 30, 20, 50);
+    bool corners_ok = corners.getExtremePoints() == std::vector<Point>{{0, 0, 0}};
+    corners.putItem(corner_a, {0, 0, 0});
+    corners_ok = corners_ok && corners.getExtremePoints() == std::vector<Point>{{50, 0, 0}, {0, 50, 0}, {0, 0, 50}};
+    corners.putItem(corner_b, {50, 0, 0});
+    corners_ok = corners_ok &&
+                 corners.getExtremePoints() == std::vector<Point>{{0, 50, 0}, {50, 50, 0}, {0, 0, 50}, {50, 0, 50}};
+    corners.putItem(corner_c, {0, 0, 50});
+    corners_ok = corners_ok && corners.getExtremePoints() ==
+                                   std::vector<Point>{{0, 50, 0}, {50, 50, 0}, {30, 0, 50}, {50, 0, 50}, {0, 20, 50}};
+    std::cout << "Extreme points follow placements: " << (corners_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Rolling back to a mark restores the bin exactly, so the same
+    // placements can be tried again with the same outcome
+    Packer undo;
+    undo.addBin(Bin("Bin 1", 100, 100, 100));
+    undo.addItemType({30, 40, 50}, {}, 0, 0.0f, 12, "Box");
+    Bin& undo_bin = undo.bins[0];
+    auto place = [&](ItemHandle k) {
+        const auto points = undo_bin.getExtremePoints();
+        for (const auto& point : points) {
+            if (undo_bin.putItem(undo.items[k], point)) return true;
+        }
+        return false;
+    };
+    place(0);
+    place(1);
+    const auto marked_points = undo_bin.getExtremePoints();
+    const BinMark undo_mark = undo_bin.mark();
+    std::vector<std::tuple<long, long, long>> tried;
+    for (ItemHandle k = 2; k < 12; ++k) {
+        if (place(k)) tried.push_back(undo.items[k].getPosition());
+    }
+    undo_bin.rollback(undo_mark);
+    bool undo_ok = undo_bin.itemCount() == 2 && undo_bin.getExtremePoints() == marked_points && tried.size() > 4;
+    std::vector<std::tuple<long, long, long>> replayed;
+    for (ItemHandle k = 2; k < 12; ++k) {
+        if (place(k)) replayed.push_back(undo.items[k].getPosition());
+    }
+    undo_ok = undo_ok && replayed == tried;
+    std::cout << "Rollback restores the bin to its mark: " << (undo_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Room first-fit learned on a full bin is retired by the rollback, so the
+    // space it frees is found again
+    Packer refill;
+    refill.addBin(Bin("Bin 1", 100, 100, 100));
+    refill.addItemType({50, 50, 50}, {}, 0, 0.0f, 9, "Cube");
+    refill.addItem(Item("Slab", 50, 100, 100, {RotationType::whd}));
+    Bin& refill_bin = refill.bins[0];
+    bool refill_ok = refill_bin.putItemFirstFit(refill.items[0]);
+    const BinMark refill_mark = refill_bin.mark();
+    for (ItemHandle k = 1; k < 8; ++k) {
+        refill_ok = refill_ok && refill_bin.putItemFirstFit(refill.items[k]);
+    }
+    refill_ok = refill_ok && !refill_bin.putItemFirstFit(refill.items[8]) && !refill_bin.putItemFirstFit(refill.items[9]);
+    refill_bin.rollback(refill_mark);
+    refill_ok = refill_ok && refill_bin.putItemFirstFit(refill.items[9]) && refill_bin.itemCount() == 2;
+    std::cout << "First fit finds the room a rollback frees: " << (refill_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // A committed mark is closed for good, even once a new mark takes its depth
+    Packer stale;
+    stale.addBin(Bin("Bin 1", 100, 100, 100));
+    stale.addItemType({50, 50, 50}, {}, 0, 0.0f, 3, "Cube");
+    Bin& stale_bin = stale.bins[0];
+    const BinMark committed = stale_bin.mark();
+    stale_bin.putItem(stale.items[0], {0, 0, 0});
+    stale_bin.putItem(stale.items[1], {50, 0, 0});
+    stale_bin.commit(committed);
+    const BinMark reopened = stale_bin.mark();
+    stale_bin.putItem(stale.items[2], {0, 50, 0});
+    bool stale_ok = false;
+    try {
+        stale_bin.rollback(committed);
+    } catch (const std::logic_error&) {
+        stale_ok = stale_bin.itemCount() == 3;
+    }
+    stale_bin.rollback(reopened);
+    stale_ok = stale_ok && stale_bin.itemCount() == 2;
+    try {
+        stale_bin.commit(reopened);
+        stale_ok = false;
+    } catch (const std::logic_error&) {
+    }
+    std::cout << "Closed marks are rejected: " << (stale_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // A bin used without a packer keeps its own copies of what it holds
+    Bin loose("Loose", 100, 100, 100);
+    Item loose_a("A", 50, 50, 50), loose_b("B", 50, 50, 50);
+    bool loose_ok = loose.putItem(loose_a, {0, 0, 0}) && loose.putItem(loose_b, {50, 0, 0});
+    const Bin loose_copy = loose;
+    const auto loose_items = loose_copy.getItems();
+    loose_ok = loose_ok && loose_items.size() == 2 && loose_items[0].get().getName() == "A" &&
+               loose_items[1].get().getPosition() == std::make_tuple(50L, 0L, 0L);
+    std::cout << "Standalone bins resolve their items: " << (loose_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // A reset packer reuses its item slots and packs the next order the same way
+    const Item* first_slot = &bulk.getItems()[0];
+    bulk.reset();
+    bulk.addItems(3, bulk_dims, nullptr, nullptr, bulk_masks);
+    bulk.pack();
+    int32_t reuse_bins[3];
+    bulk.writePlacements(reuse_bins, bulk_pos, bulk_rot, bulk_packed);
+    bool reuse_ok = &bulk.getItems()[0] == first_slot && bulk.getItems().size() == 3 &&
+                    std::equal(reuse_bins, reuse_bins + 3, bulk_bins) && bulk.getUnfitItems().size() == 2;
+    std::cout << "Reset packer reuses its item storage: " << (reuse_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Every rejected attempt is attributed to exactly one reason
+    const PackStats& stats = bulk.stats();
+    bool stats_ok = stats.packs_run == 1 && stats.put_attempts > 0 &&
+                    stats.put_attempts == stats.put_accepted + stats.rejected_out_of_bounds +
+                        stats.rejected_bottom_load_only + stats.rejected_disable_stacking +
+                        stats.rejected_overlap + stats.rejected_unsupported + stats.rejected_overweight +
+                        stats.rejected_off_balance &&
+                    stats.rejected_overlap > 0 && stats.seconds_total >= stats.seconds_packing;
+    std::cout << "Pack stats account for every attempt: " << (stats_ok ? "PASSED" : "FAILED") << std::endl;
+
+    // Records from concurrent threads all reach the sink, one line each
+    std::FILE* log_file = std::tmpfile();
+    set_log_output(log_file);
+    enable_log(true);
+    std::vector<std::thread> loggers;
+    for (int t = 0; t < 4; ++t) {
+        loggers.emplace_back([t]() {
+            for (int i = 0; i < 200; ++i) {
+                log_warn("test", "record", LogField("t", t), LogField("i", i), LogField("ratio", 0.5));
+            }
+        });
+    }
+    for (auto& thread : loggers) {
+        thread.join();
+    }
+    flush_log();
+    enable_log(false);
+    set_log_output(stdout);
+    std::rewind(log_file);
+    int log_lines = 0;
+    for (int c; (c = std::fgetc(log_file)) != EOF;) {
+        log_lines += c == '\n';
+    }
+    std::fclose(log_file);
+    bool log_ok = log_lines + static_cast<int>(dropped_log_records()) == 800;
+    std::cout << "Async log writes every record once: " << (log_ok ? "PASSED" : "FAILED") << std::endl;
+
+    runAllocationTest("Placement attempts do not allocate (linear scan).", 100, 50);
+    runAllocationTest("Placement attempts do not allocate (grid index).", 100, 20);
+    runAcceptAllocationTest("Repeated accepted placements do not allocate (linear scan).", 100, 50);
+    runAcceptAllocationTest("Repeated accepted placements do not allocate (grid index).", 100, 20);
+
     return 0;
 }
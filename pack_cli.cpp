@@ -0,0 +1,194 @@
+// Batch packing without Python. Reads one JSON problem per line (format in
+// include/problem_io.h) from FILE, or stdin when FILE is absent or "-", and
+// streams one JSON result per line to stdout in input order.
+//
+//   pack_cli [--threads N] [--window N] [--cache-file PATH] [FILE]
+//
+// A reader thread parses lines while N workers pack them, one problem per
+// worker at a time (0, the default, means one per hardware thread). At most
+// --window problems (default 4 per worker) are in flight between the reader
+// and stdout, so memory stays bounded however long the input is. A line that
+// fails to parse or pack gets a result with an "error" field instead, and the
+// exit status is 1. --cache-file keeps results in a ResultCache backed by
+// that file, so repeated problems across runs are not packed again.
+#include "packer.h"
+#include "problem_io.h"
+#include "result_cache.h"
+#include "thread_pool.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// State shared by the reader, the workers and the writer.
+struct Pipeline {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<size_t, std::string> finished;  // results waiting for their turn, by sequence number
+    size_t issued = 0;   // problems handed out so far
+    size_t written = 0;  // results written so far
+    size_t errors = 0;
+    bool reading = true;
+
+    void finish(size_t sequence, std::string result, bool failed) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.emplace(sequence, std::move(result));
+            errors += failed ? 1 : 0;
+        }
+        changed.notify_all();
+    }
+};
+
+void packOne(Pipeline& pipeline, ResultCache* cache, std::unique_ptr<PackRequest> request, size_t sequence,
+             size_t line) {
+    const auto start = Clock::now();
+    std::string result;
+    bool failed = false;
+    try {
+        // The pipeline already keeps every worker busy
+        PackOptions options = request->options;
+        options.threads = 1;
+        options = startClock(options, start);
+        if (cache) {
+            cache->pack(request->packer, options);
+        } else {
+            request->packer.pack(options);
+        }
+        result = formatPackResult(*request, line, secondsSince(start));
+    } catch (const std::exception& error) {
+        result = formatPackError(request->id, line, error.what());
+        failed = true;
+    }
+    request.reset();  // the problem is done with before its result waits for its turn
+    pipeline.finish(sequence, std::move(result), failed);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t threads = 0;
+    size_t window = 0;
+    std::string cache_file;
+    std::string input_path = "-";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            window = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--cache-file") == 0 && i + 1 < argc) {
+            cache_file = argv[++i];
+        } else if (argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0) {
+            input_path = argv[i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--threads N] [--window N] [--cache-file PATH] [FILE]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::ifstream file;
+    if (input_path != "-") {
+        file.open(input_path);
+        if (!file) {
+            std::cerr << argv[0] << ": cannot open " << input_path << std::endl;
+            return 1;
+        }
+    }
+    std::istream& input = input_path == "-" ? std::cin : file;
+    std::ios::sync_with_stdio(false);
+
+    std::unique_ptr<ResultCache> cache;
+    if (!cache_file.empty()) {
+        cache = std::make_unique<ResultCache>();
+        if (!cache->openFile(cache_file)) {
+            std::cerr << argv[0] << ": cannot map " << cache_file << ", caching in memory only" << std::endl;
+        }
+    }
+
+    const auto start = Clock::now();
+    Pipeline pipeline;
+    ThreadPool workers(threads);
+    if (window == 0) {
+        window = 4 * workers.size();
+    }
+
+    std::thread reader([&]() {
+        std::string text;
+        size_t line = 0;
+        while (std::getline(input, text)) {
+            ++line;
+            if (text.find_first_not_of(" \t\r") == std::string::npos) continue;
+            size_t sequence;
+            {
+                std::unique_lock<std::mutex> lock(pipeline.mutex);
+                pipeline.changed.wait(lock, [&]() { return pipeline.issued - pipeline.written < window; });
+                sequence = pipeline.issued++;
+            }
+            std::unique_ptr<PackRequest> request;
+            try {
+                request = std::make_unique<PackRequest>(parsePackRequest(text));
+            } catch (const std::exception& error) {
+                pipeline.finish(sequence, formatPackError("", line, error.what()), true);
+                continue;
+            }
+            // std::function needs a copyable job, so the request rides in a shared_ptr
+            auto job = std::make_shared<std::unique_ptr<PackRequest>>(std::move(request));
+            workers.submit([&pipeline, &cache, job, sequence, line]() {
+                packOne(pipeline, cache.get(), std::move(*job), sequence, line);
+            });
+        }
+        {
+            std::lock_guard<std::mutex> lock(pipeline.mutex);
+            pipeline.reading = false;
+        }
+        pipeline.changed.notify_all();
+    });
+
+    // Write results in input order as they come in, flushing whenever the
+    // next one is not ready yet, so downstream readers see them promptly
+    std::unique_lock<std::mutex> lock(pipeline.mutex);
+    while (true) {
+        pipeline.changed.wait(lock, [&]() {
+            return (!pipeline.finished.empty() && pipeline.finished.begin()->first == pipeline.written) ||
+                   (!pipeline.reading && pipeline.written == pipeline.issued);
+        });
+        if (pipeline.finished.empty() || pipeline.finished.begin()->first != pipeline.written) {
+            break;
+        }
+        std::string result = std::move(pipeline.finished.begin()->second);
+        pipeline.finished.erase(pipeline.finished.begin());
+        ++pipeline.written;
+        const bool next_ready = !pipeline.finished.empty() && pipeline.finished.begin()->first == pipeline.written;
+        lock.unlock();
+        pipeline.changed.notify_all();
+        std::cout << result << '\n';
+        if (!next_ready) {
+            std::cout.flush();
+        }
+        lock.lock();
+    }
+    const size_t problems = pipeline.written;
+    const size_t errors = pipeline.errors;
+    lock.unlock();
+    reader.join();
+    std::cout.flush();
+
+    std::cerr << argv[0] << ": " << problems << " problems, " << errors << " errors, " << secondsSince(start)
+              << " s" << std::endl;
+    return errors ? 1 : 0;
+}
@@ -11,7 +11,7 @@ import pybind11
 ext_modules = [
     Extension(
         'pybinding',
-        sources=['src/item.cpp', 'src/pybinding.cpp', 'src/box.cpp', 'src/bin.cpp', 'src/packer.cpp', 'src/utils.cpp', 'src/log.cpp'],
+        sources=['src/item.cpp', 'src/pybinding.cpp', 'src/box.cpp', 'src/bin.cpp', 'src/packer.cpp', 'src/utils.cpp', 'src/log.cpp', 'src/spatial_grid.cpp', 'src/placed_boxes.cpp', 'src/thread_pool.cpp', 'src/pack_stats.cpp', 'src/item_arena.cpp', 'src/height_map.cpp', 'src/pallet.cpp', 'src/pallet_packer.cpp', 'src/bounds.cpp', 'src/result_cache.cpp'],
         include_dirs=["include", pybind11.get_include()],
         language='c++'
     ),
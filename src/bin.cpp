@@ -4,31 +4,354 @@
 #include <sstream>
 #include <iostream>
 #include <functional> 
+#include <stdexcept>
 
 Bin::Bin(const std::string& name, long w, long h, long d, float max_weight, const std::string& image, const std::string& description, int id) 
-    : Box(name, w, h, d), max_weight(max_weight), image(image), description(description), id(id) {
+    : Box(name, w, h, d), id(id), max_weight(max_weight), image(image), description(description) {
 }
 
-const std::vector<std::reference_wrapper<Item>>& Bin::getItems() const {
+void BinLoad::add(const Aabb& box, double item_weight) {
+    const double box_volume = static_cast<double>(box.max[0] - box.min[0]) * (box.max[1] - box.min[1]) *
+                              (box.max[2] - box.min[2]);
+    weight += item_weight;
+    volume += box_volume;
+    for (size_t axis = 0; axis < 3; ++axis) {
+        const double centre = 0.5 * (box.min[axis] + box.max[axis]);
+        weight_moment[axis] += item_weight * centre;
+        volume_moment[axis] += box_volume * centre;
+    }
+}
+
+double CogEnvelope::gap(const std::array<double, 3>& point) const {
+    double squared = 0;
+    for (size_t axis = 0; axis < 3; ++axis) {
+        const double out = std::max({min[axis] - point[axis], point[axis] - max[axis], 0.0});
+        squared += out * out;
+    }
+    return std::sqrt(squared);
+}
+
+namespace {
+
+std::array<double, 3> centreOf(const BinLoad& load) {
+    const bool weighted = load.weight > 0;
+    const double total = weighted ? load.weight : load.volume;
+    const auto& moment = weighted ? load.weight_moment : load.volume_moment;
+    return {moment[0] / total, moment[1] / total, moment[2] / total};
+}
+
+} // namespace
+
+std::vector<std::reference_wrapper<Item>> Bin::getItems() const {
+    if (!arena && !items.empty()) {
+        throw std::logic_error("Bin::getItems: bin is not attached to an item arena");
+    }
+    std::vector<std::reference_wrapper<Item>> resolved;
+    resolved.reserve(items.size());
+    for (auto handle : items) {
+        resolved.push_back(std::ref((*arena)[handle]));
+    }
+    return resolved;
+}
+
+const std::vector<ItemHandle>& Bin::getItemHandles() const {
     return items;
 }
 
-void Bin::setItems(const std::vector<std::reference_wrapper<Item>>& items) {
+size_t Bin::itemCount() const {
+    return items.size();
+}
+
+void Bin::setItems(const std::vector<ItemHandle>& items) {
     this->items = items;
+    rebuildIndex();
+}
+
+void Bin::attach(ItemArena* arena) {
+    this->arena = arena;
+    own_items.reset();
+}
+
+void Bin::attach(std::shared_ptr<ItemArena> arena) {
+    this->arena = arena.get();
+    own_items = std::move(arena);
+}
+
+ItemHandle Bin::handleFor(const Item& item) {
+    if (arena && !own_items) {
+        return item.input_index;
+    }
+    if (!own_items) {
+        own_items = std::make_shared<ItemArena>();
+        arena = own_items.get();
+    }
+    return own_items->add(item);
 }
 
 void Bin::addItem(Item& item) {
-    items.push_back(std::ref(item));
+    items.push_back(handleFor(item));
+    indexBox(boxFor(item), item.disablesStacking(), item.getWeight());
 }
 
-float Bin::scoreRotation(const Item& item, long rotationType) const {
-    Item rotatedItem = item;
-    rotatedItem.setRotationType(static_cast<RotationType>(rotationType));
-    auto d = rotatedItem.getDimension();
+Aabb Bin::boxFor(const Item& item) const {
+    return item.getBounds();
+}
+
+const std::vector<std::tuple<long, long, long>>& Bin::getExtremePoints() const {
+    return extreme_points;
+}
+
+void Bin::indexBox(const Aabb& box, bool disable_stacking, float weight) {
+    insertBox(box, disable_stacking, weight);
+    updateExtremePoints(box);
+}
+
+void Bin::insertBox(const Aabb& box, bool disable_stacking, float weight) {
+    if (!index.covers(getWidth(), getHeight(), getDepth())) {
+        index.reset(getWidth(), getHeight(), getDepth());
+    }
+    if (!heights.covers(getWidth(), getDepth())) {
+        heights.reset(getWidth(), getDepth());
+    }
+    index.insert(static_cast<uint32_t>(boxes.size()), box);
+    heights.insert(box, disable_stacking);
+    room_bound_valid = false;
+    boxes.push_back(box, disable_stacking);
+    if (disable_stacking) {
+        ++stacking_blocked;
+    }
+    load.add(box, weight);
+}
+
+void Bin::rebuildIndex() {
+    boxes.clear();
+    index.clear();
+    heights.clear();
+    stacking_blocked = 0;
+    load = BinLoad{};
+    extreme_points = {{0, 0, 0}};
+    point_journal.clear();
+    open_marks.clear();
+    dropRoom();
+    if (!arena && !items.empty()) {
+        throw std::logic_error("Bin::setItems: bin is not attached to an item arena");
+    }
+    for (auto handle : items) {
+        const Item& item = (*arena)[handle];
+        indexBox(boxFor(item), item.disablesStacking(), item.getWeight());
+    }
+}
+
+// Below this many placed items a straight SIMD sweep beats the grid lookup.
+constexpr size_t LINEAR_SCAN_LIMIT = 32;
+
+bool Bin::collides(const Aabb& box) const {
+    if (boxes.size() <= LINEAR_SCAN_LIMIT) {
+        return boxes.anyOverlap(box);
+    }
+    // Sized here, not per query, so rejected attempts never allocate
+    if (candidates.capacity() < boxes.size()) {
+        candidates.reserve(boxes.size());
+    }
+    candidates.clear();
+    index.query(box, [this](uint32_t i) {
+        candidates.push_back(i);
+        return false;
+    });
+    return boxes.anyOverlap(box, candidates.data(), candidates.size());
+}
+
+bool Bin::collidesWith(const Aabb& box, Aabb& hit) const {
+    bool found = false;
+    long nearest = 0;
+    auto consider = [&](uint32_t i) {
+        const Aabb placed = boxes[i];
+        if (!placed.overlaps(box)) return;
+        long offset = 0;
+        for (size_t axis = 0; axis < 3; ++axis) {
+            offset += std::max(placed.min[axis] - box.min[axis], 0L);
+        }
+        if (!found || offset < nearest) {
+            hit = placed;
+            nearest = offset;
+            found = true;
+        }
+    };
+    if (boxes.size() <= LINEAR_SCAN_LIMIT) {
+        for (uint32_t i = 0; i < boxes.size(); ++i) consider(i);
+    } else {
+        index.query(box, [&](uint32_t i) {
+            consider(i);
+            return false;
+        });
+    }
+    return found;
+}
+
+bool Bin::isOccupied(const std::array<long, 3>& point) const {
+    return collides({point, {point[0] + 1, point[1] + 1, point[2] + 1}});
+}
+
+long Bin::project(const std::array<long, 3>& point, size_t axis) const {
+    // Slide the point towards 0 along `axis` until it meets a wall or the far
+    // face of a placed item.
+    Aabb ray = {point, {point[0] + 1, point[1] + 1, point[2] + 1}};
+    ray.min[axis] = 0;
+    long stop = 0;
+    index.query(ray, [&](uint32_t i) {
+        if (boxes[i].overlaps(ray) && boxes[i].max[axis] <= point[axis]) {
+            stop = std::max(stop, boxes[i].max[axis]);
+        }
+        return false;
+    });
+    return stop;
+}
+
+namespace {
+// Extreme points are kept sorted back to front, bottom to top, left to right
+bool pointBefore(const std::tuple<long, long, long>& a, const std::tuple<long, long, long>& b) {
+    return std::tie(std::get<2>(a), std::get<1>(a), std::get<0>(a)) <
+           std::tie(std::get<2>(b), std::get<1>(b), std::get<0>(b));
+}
+}
+
+void Bin::insertPoint(const std::tuple<long, long, long>& point) {
+    auto it = std::lower_bound(extreme_points.begin(), extreme_points.end(), point, pointBefore);
+    if (it == extreme_points.end() || *it != point) {
+        extreme_points.insert(it, point);
+        if (!open_marks.empty()) {
+            point_journal.emplace_back(point, true);
+        }
+    }
+}
+
+void Bin::erasePoint(const std::tuple<long, long, long>& point) {
+    auto it = std::lower_bound(extreme_points.begin(), extreme_points.end(), point, pointBefore);
+    if (it != extreme_points.end() && *it == point) {
+        extreme_points.erase(it);
+        point_room.erase(point);
+    }
+}
+
+void Bin::updateExtremePoints(const Aabb& placed) {
+    const std::array<long, 3> extent = {getWidth(), getHeight(), getDepth()};
+
+    // Points swallowed by the new item are no longer usable
+    extreme_points.erase(
+        std::remove_if(extreme_points.begin(), extreme_points.end(), [&](const auto& p) {
+            const Aabb cell = {{std::get<0>(p), std::get<1>(p), std::get<2>(p)},
+                               {std::get<0>(p) + 1, std::get<1>(p) + 1, std::get<2>(p) + 1}};
+            if (!placed.overlaps(cell)) {
+                return false;
+            }
+            if (!open_marks.empty()) {
+                point_journal.emplace_back(p, false);
+            }
+            point_room.erase(p);
+            return true;
+        }),
+        extreme_points.end());
+
+    // Each of the three outer corners is projected along the two other axes
+    for (size_t axis = 0; axis < 3; ++axis) {
+        std::array<long, 3> corner = placed.min;
+        corner[axis] = placed.max[axis];
+        if (corner[axis] >= extent[axis]) {
+            continue;
+        }
+        for (size_t along = 0; along < 3; ++along) {
+            if (along == axis) continue;
+            std::array<long, 3> point = corner;
+            point[along] = project(corner, along);
+            if (isOccupied(point)) continue;
+
+            insertPoint({point[0], point[1], point[2]});
+        }
+    }
+}
+
+BinMark Bin::mark() {
+    if (boxes.size() != items.size()) {
+        rebuildIndex();
+    }
+    open_marks.push_back(++mark_epoch);
+    return {items.size(), point_journal.size(), open_marks.size(), mark_epoch, load};
+}
+
+bool Bin::isOpen(const BinMark& mark) const {
+    return mark.depth > 0 && mark.depth <= open_marks.size() && open_marks[mark.depth - 1] == mark.epoch &&
+           mark.items <= items.size() && mark.points <= point_journal.size();
+}
+
+void Bin::removeLastBox() {
+    const auto id = static_cast<uint32_t>(boxes.size() - 1);
+    index.removeLast(id, boxes[id]);
+    heights.removeLast();
+    if (boxes.disablesStacking(id)) {
+        --stacking_blocked;
+    }
+    boxes.pop_back();
+}
 
-    if (getWidth() < d[0] || getHeight() < d[1] || getDepth() < d[2]) {
+void Bin::dropRoom() {
+    point_room.clear();
+    room_bound_valid = false;
+}
+
+void Bin::rollback(const BinMark& mark) {
+    if (!isOpen(mark)) {
+        throw std::logic_error("Bin::rollback: mark is no longer open");
+    }
+    if (items.size() > mark.items) {
+        // Removed boxes free space the cached rooms miss. Retire them all at
+        // once; each is recomputed when next scanned, not cleared here.
+        ++room_generation;
+        room_bound_valid = false;
+    }
+    while (items.size() > mark.items) {
+        removeLastBox();
+        items.pop_back();
+    }
+    // Restored whole rather than subtracted, so totals do not drift
+    load = mark.load;
+    // The point list is a sorted set, so edits are undone by value
+    while (point_journal.size() > mark.points) {
+        const auto& [point, inserted] = point_journal.back();
+        if (inserted) {
+            erasePoint(point);
+        } else {
+            auto it = std::lower_bound(extreme_points.begin(), extreme_points.end(), point, pointBefore);
+            extreme_points.insert(it, point);
+        }
+        point_journal.pop_back();
+    }
+    closeMark(mark);
+}
+
+void Bin::commit(const BinMark& mark) {
+    if (!isOpen(mark)) {
+        throw std::logic_error("Bin::commit: mark is no longer open");
+    }
+    closeMark(mark);
+}
+
+void Bin::closeMark(const BinMark& mark) {
+    open_marks.resize(mark.depth - 1);
+    if (open_marks.empty()) {
+        point_journal.clear();
+    }
+}
+
+bool Bin::fitsRotation(const Item& item, RotationType rotation) const {
+    const auto d = item.getDims(rotation);
+    return d[0] <= getWidth() && d[1] <= getHeight() && d[2] <= getDepth();
+}
+
+float Bin::scoreRotation(const Item& item, long rotationType) const {
+    if (!fitsRotation(item, static_cast<RotationType>(rotationType))) {
         return 0;
     }
+    const auto d = item.getDims(static_cast<RotationType>(rotationType));
     float widthScore = std::pow(static_cast<float>(d[0]) / getWidth(), 2);
     float heightScore = std::pow(static_cast<float>(d[1]) / getHeight(), 2);
     float depthScore = std::pow(static_cast<float>(d[2]) / getDepth(), 2);
@@ -37,129 +360,446 @@ float Bin::scoreRotation(const Item& item, long rotationType) const {
     return score;
 }
 
-std::vector<long> Bin::getBestRotationOrder(const Item& item) const {
-    // Use map to maintain same structure as Python dictionary
-    std::map<long, float> rotationScores;
-    // Score all rotation types
+RotationOrder Bin::rankRotations(const Item& item) const {
+    // Each allowed rotation once, in enum order, so equal scores keep the
+    // same tie order as before
+    bool allowed[6] = {};
     for (auto rotation : item.getAllowedRotations()) {
-        // Explicitly cast RotationType to long for map key
-        long rotationInt = static_cast<long>(rotation);
-        rotationScores[rotationInt] = scoreRotation(item, rotationInt);
+        allowed[static_cast<size_t>(rotation)] = true;
     }
-    
-    // Convert map to vector for sorting
+
+    RotationOrder order;
+    std::array<float, 6> scores;
+    for (size_t r = 0; r < 6; ++r) {
+        if (!allowed[r]) continue;
+        const float score = scoreRotation(item, static_cast<long>(r));
+        // Stable insertion by descending score
+        size_t pos = order.count;
+        while (pos > 0 && scores[pos - 1] < score) {
+            order.rotations[pos] = order.rotations[pos - 1];
+            scores[pos] = scores[pos - 1];
+            --pos;
+        }
+        order.rotations[pos] = static_cast<RotationType>(r);
+        scores[pos] = score;
+        ++order.count;
+    }
+    return order;
+}
+
+std::vector<long> Bin::getBestRotationOrder(const Item& item) const {
     std::vector<long> bestRotations;
-    bestRotations.reserve(rotationScores.size());
-    
-    // Extract keys and sort them based on their corresponding values
-    for (const auto& [rotation, _] : rotationScores) {
-        bestRotations.push_back(rotation);
+    for (auto rotation : rankRotations(item)) {
+        bestRotations.push_back(static_cast<long>(rotation));
     }
-    
-    std::sort(bestRotations.begin(), bestRotations.end(),
-              [&rotationScores](long a, long b) {
-                  return rotationScores[a] > rotationScores[b];
-              });
-    
     return bestRotations;
 }
 
+const RotationOrder& Bin::getRotationPlan(const Item& item) const {
+    const std::array<long, 3> extent = {getWidth(), getHeight(), getDepth()};
+    if (plan_extent != extent) {
+        rotation_plans.clear();
+        plan_extent = extent;
+    }
+
+    PlanKey key = {item.getWidth(), item.getHeight(), item.getDepth(), 0};
+    for (auto rotation : item.getAllowedRotations()) {
+        key.allowed |= 1u << static_cast<unsigned>(rotation);
+    }
+    auto it = rotation_plans.find(key);
+    if (it != rotation_plans.end()) {
+        return it->second;
+    }
+
+    RotationOrder plan;
+    std::array<Dimension, 6> seen;
+    for (auto rotation : rankRotations(item)) {
+        // Checked apart from the score, which is 0 for a zero-size item too
+        if (!fitsRotation(item, rotation)) continue;
+        const auto d = item.getDims(rotation);
+        if (std::find(seen.begin(), seen.begin() + plan.count, d) != seen.begin() + plan.count) continue;
+        seen[plan.count] = d;
+        plan.rotations[plan.count++] = rotation;
+    }
+    return rotation_plans.emplace(key, plan).first->second;
+}
+
+Bin::Fit Bin::checkFit(const Item& item, const Aabb& box) const {
+    const long y = box.min[1];
+
+    // disable_stacking applies to anything sharing the x/z footprint, at any height
+    if ((item.disablesStacking() && heights.anyBelow(box, y)) ||
+        (stacking_blocked > 0 && heights.stackingBlockedAbove(box, y))) {
+        return Fit::disable_stacking;
+    }
+
+    // Only items registered in the grid cells around the candidate can collide
+    return collides(box) ? Fit::overlap : Fit::fits;
+}
+
+Bin::Fit Bin::checkRest(const Item& item, Aabb& box) const {
+    // Whatever is between the surface and the fitting box is free, so the drop is safe
+    const long rest = heights.restingHeight(box, box.min[1]);
+    box.max[1] -= box.min[1] - rest;
+    box.min[1] = rest;
+    if (item.bottomLoadOnly() && rest != 0) {
+        return Fit::bottom_load_only;
+    }
+    if (min_support > 0 && heights.supportedFraction(box) < min_support) {
+        return Fit::unsupported;
+    }
+    return Fit::fits;
+}
+
+double Bin::supportRatio(const Item& item) const {
+    return heights.supportedFraction(boxFor(item));
+}
+
+double Bin::getFillRatio() const {
+    const double capacity = static_cast<double>(getWidth()) * getHeight() * getDepth();
+    return capacity > 0 ? load.volume / capacity : 0;
+}
+
+std::array<double, 3> Bin::getCentreOfGravity() const {
+    if (load.volume <= 0) {
+        return {0.5 * getWidth(), 0.0, 0.5 * getDepth()};
+    }
+    return centreOf(load);
+}
+
+std::array<double, 2> Bin::getAxleLoads() const {
+    const double near = axle_z[0] < 0 ? getDepth() : axle_z[0];
+    const double far = axle_z[1] < 0 ? getDepth() : axle_z[1];
+    if (load.weight <= 0 || near == far) {
+        return {load.weight / 2, load.weight / 2};
+    }
+    const double share = (getCentreOfGravity()[2] - near) / (far - near);
+    return {load.weight * (1 - share), load.weight * share};
+}
+
+bool Bin::keepsBalance(const Aabb& box, double weight) const {
+    if (!cog_envelope.enabled || load.volume <= 0) {
+        return true;
+    }
+    BinLoad after = load;
+    after.add(box, weight);
+    return cog_envelope.gap(centreOf(after)) <= cog_envelope.gap(centreOf(load)) + 1e-9;
+}
+
 bool Bin::putItem(Item& item, const std::tuple<long, long, long>& p) {
+    countStat(&PackStats::put_attempts);
+
     // Quick rejection checks
     const long x = std::get<0>(p);
     const long y = std::get<1>(p);
     const long z = std::get<2>(p);
     
-    // CRITICAL FIX: Fast rejection for common cases
-    if ((item.bottom_load_only && y != 0) || 
-        x < 0 || y < 0 || z < 0 ||
+    if (x < 0 || y < 0 || z < 0 ||
         x >= getWidth() || y >= getHeight() || z >= getDepth()) {
+        countStat(&PackStats::rejected_out_of_bounds);
         return false;
     }
     
-    // CRITICAL FIX: Only try the single best rotation
-    // This reduces the number of expensive intersection checks
-    auto rotations = getBestRotationOrder(item);
-    item.setPosition({x, y, z});
-    item.setRotationType(static_cast<RotationType>(rotations[0]));
-    auto d = item.getDimension();
-    
-    // Check bin boundaries
-    if (getWidth() < x + d[0] || getHeight() < y + d[1] || getDepth() < z + d[2]) {
-        return false; // Don't try other rotations - increase speed
+    // Python callers may edit `items` directly; resync the index if so
+    if (boxes.size() != items.size()) {
+        rebuildIndex();
     }
-    
-    // CRITICAL FIX: Optimized intersection checks
-    for (const auto& other_ref : items) {
-        const auto& other = other_ref.get();
-        
-        // Quick disable_stacking check
-        if ((item.disable_stacking && y > std::get<1>(other.getPosition())) || 
-            (other.disable_stacking && std::get<1>(other.getPosition()) > y)) {
-                
-            // Check for X-Z overlap
-            const auto& other_pos = other.getPosition();
-            const auto& other_dim = other.getDimension();
-            
-            bool x_overlap = (x < std::get<0>(other_pos) + other_dim[0]) && 
-                            (x + d[0] > std::get<0>(other_pos));
-            bool z_overlap = (z < std::get<2>(other_pos) + other_dim[2]) && 
-                            (z + d[2] > std::get<2>(other_pos));
-                            
-            if (x_overlap && z_overlap) {
+
+    if (max_weight > 0 && load.weight + item.getWeight() > max_weight) {
+        countStat(&PackStats::rejected_overweight);
+        return false;
+    }
+
+    // Fast rejection: a surface under the corner stops any footprint from reaching the floor
+    if (item.bottomLoadOnly() && y != 0 && heights.restingHeight({{x, 0, z}, {x + 1, 1, z + 1}}, y) > 0) {
+        countStat(&PackStats::rejected_bottom_load_only);
+        return false;
+    }
+
+    // Try every distinct rotation that fits the bin, best scoring first
+    const auto& rotations = getRotationPlan(item);
+    Aabb box;
+    Fit fit = Fit::out_of_bounds;
+    for (auto rotation : rotations) {
+        const auto d = item.getDims(rotation);
+        if (getWidth() < x + d[0] || getHeight() < y + d[1] || getDepth() < z + d[2]) {
+            continue;
+        }
+        box = {{x, y, z}, {x + d[0], y + d[1], z + d[2]}};
+        Fit result = checkFit(item, box);
+        if (result == Fit::fits) {
+            result = checkRest(item, box);
+        }
+        if (result == Fit::fits && !keepsBalance(box, item.getWeight())) {
+            result = Fit::off_balance;
+        }
+        if (result == Fit::fits) {
+            item.setRotationType(rotation);
+            fit = result;
+            break;
+        }
+        fit = std::max(fit, result);
+    }
+    if (fit != Fit::fits) {
+        countStat(fit == Fit::off_balance ? &PackStats::rejected_off_balance
+                  : fit == Fit::unsupported ? &PackStats::rejected_unsupported
+                  : fit == Fit::bottom_load_only ? &PackStats::rejected_bottom_load_only
+                  : fit == Fit::overlap ? &PackStats::rejected_overlap
+                  : fit == Fit::disable_stacking ? &PackStats::rejected_disable_stacking
+                  : &PackStats::rejected_out_of_bounds);
+        return false;
+    }
+    countStat(&PackStats::put_accepted);
+
+    // checkRest already lowered the box onto the surface below it
+    item.setPosition({x, box.min[1], z});
+    items.push_back(handleFor(item));
+    indexBox(box, item.disablesStacking(), item.getWeight());
+    return true;
+}
+
+long Bin::freeRun(const Aabb& base, size_t axis, long limit) const {
+    // `base` is free, so anything in the stretched region lies beyond it
+    Aabb region = base;
+    region.max[axis] = limit;
+    long stop = limit;
+    if (boxes.empty()) {
+        return stop;
+    }
+    index.query(region, [&](uint32_t i) {
+        if (boxes[i].overlaps(region)) {
+            stop = std::min(stop, boxes[i].min[axis]);
+        }
+        return false;
+    });
+    return stop;
+}
+
+bool Bin::blockRests(const Item& item, const Aabb& block, const Dimension& d) const {
+    Aabb rested = block;
+    if (checkRest(item, rested) != Fit::fits) {
+        return false;
+    }
+    if (rested.min[1] == 0) {
+        return true;
+    }
+    // Every unit of the bottom layer needs its own support, not just the
+    // block: a unit resting on nothing would only be held up by its neighbours
+    for (long uz = rested.min[2]; uz < rested.max[2]; uz += d[2]) {
+        for (long ux = rested.min[0]; ux < rested.max[0]; ux += d[0]) {
+            const Aabb unit = {{ux, rested.min[1], uz}, {ux + d[0], rested.min[1] + d[1], uz + d[2]}};
+            const double support = heights.supportedFraction(unit);
+            if (support <= 0 || support < min_support) {
                 return false;
             }
         }
-        
-        // CRITICAL FIX: Optimized intersection check - first check bounding boxes
-        // This is much faster than full intersection check
-        const auto& other_pos = other.getPosition();
-        const auto& other_dim = other.getDimension();
-        
-        if (x + d[0] <= std::get<0>(other_pos) || 
-            std::get<0>(other_pos) + other_dim[0] <= x ||
-            y + d[1] <= std::get<1>(other_pos) || 
-            std::get<1>(other_pos) + other_dim[1] <= y ||
-            z + d[2] <= std::get<2>(other_pos) || 
-            std::get<2>(other_pos) + other_dim[2] <= z) {
-            // No intersection possible - continue to next item
+    }
+    return true;
+}
+
+BlockShape Bin::findBlock(const Item& item, const std::tuple<long, long, long>& p, size_t limit) const {
+    BlockShape best;
+    const long x = std::get<0>(p);
+    const long y = std::get<1>(p);
+    const long z = std::get<2>(p);
+    if (limit == 0 || x < 0 || y < 0 || z < 0 || x >= getWidth() || y >= getHeight() || z >= getDepth()) {
+        return best;
+    }
+    // No more units than the weight left allows
+    if (max_weight > 0 && item.getWeight() > 0) {
+        const double room = std::max(0.0, (max_weight - load.weight) / item.getWeight());
+        limit = std::min(limit, static_cast<size_t>(room));
+        if (limit == 0) {
+            return best;
+        }
+    }
+    const long units = static_cast<long>(limit);
+    const std::array<long, 3> origin = {x, y, z};
+    const std::array<long, 3> extent = {getWidth(), getHeight(), getDepth()};
+
+    for (auto rotation : getRotationPlan(item)) {
+        const auto d = item.getDims(rotation);
+        if (x + d[0] > extent[0] || y + d[1] > extent[1] || z + d[2] > extent[2]) {
             continue;
         }
-        
-        // Items might intersect, do full check
-        if (other.doesIntersect(item)) {
-            return false;
+        Aabb box = {origin, {x + d[0], y + d[1], z + d[2]}};
+        if (checkFit(item, box) != Fit::fits) {
+            continue;
         }
-    }
 
-    // Apply "gravity" here directly instead of using a separate function
-    if (!item.bottom_load_only && y > 0) {
-        // Try placing at one level below
-        std::tuple<long, long, long> lower_pos = {x, y-1, z};
-        
-        // Check if the item can be placed lower
-        bool can_go_lower = true;
-        item.setPosition(lower_pos);
-        
-        // Quick collision check with other items
-        for (const auto& other_ref : items) {
-            if (other_ref.get().doesIntersect(item)) {
-                can_go_lower = false;
-                break;
+        // Grow the unit into a row across the width, the row into a wall
+        // upwards, and the wall backwards, each as far as the space is free
+        BlockShape shape;
+        shape.rotation = rotation;
+        shape.counts = {1, 1, 1};
+        for (size_t axis : {size_t(0), size_t(1), size_t(2)}) {
+            long wanted = units / static_cast<long>(shape.size());
+            // Units of these types may not rest on one another
+            if (axis == 1 && (item.bottomLoadOnly() || item.disablesStacking())) {
+                wanted = 1;
             }
+            wanted = std::min(wanted, (extent[axis] - origin[axis]) / d[axis]);
+            if (wanted <= 1) continue;
+            const long stop = freeRun(box, axis, origin[axis] + wanted * d[axis]);
+            shape.counts[axis] = std::max(1L, (stop - origin[axis]) / d[axis]);
+            box.max[axis] = origin[axis] + shape.counts[axis] * d[axis];
+        }
+
+        // Free space is settled; disable_stacking rules and where the block
+        // comes to rest still apply to the whole block. A single unit is left
+        // to putItem, which checks it the same way.
+        if (shape.size() > 1 && (((stacking_blocked > 0 || item.disablesStacking()) &&
+                                  checkFit(item, box) != Fit::fits) ||
+                                 !blockRests(item, box, d))) {
+            shape.counts = {1, 1, 1};
+        }
+        if (shape.size() > 1 && cog_envelope.enabled) {
+            Aabb rested = box;
+            const long drop = rested.min[1] - heights.restingHeight(box, rested.min[1]);
+            rested.min[1] -= drop;
+            rested.max[1] -= drop;
+            if (!keepsBalance(rested, static_cast<double>(item.getWeight()) * shape.size())) {
+                shape.counts = {1, 1, 1};
+            }
+        }
+        if (shape.size() > best.size()) {
+            best = shape;
         }
-        
-        // If can't go lower, reset position to original
-        if (!can_go_lower) {
-            item.setPosition({x, y, z});
+    }
+    return best;
+}
+
+void Bin::placeBlock(Item* const* units, const std::tuple<long, long, long>& p, const BlockShape& shape) {
+    if (boxes.size() != items.size()) {
+        rebuildIndex();
+    }
+    const auto d = units[0]->getDims(shape.rotation);
+    std::array<long, 3> origin = {std::get<0>(p), std::get<1>(p), std::get<2>(p)};
+    const Aabb block = {origin, {origin[0] + shape.counts[0] * d[0], origin[1] + shape.counts[1] * d[1],
+                                 origin[2] + shape.counts[2] * d[2]}};
+    origin[1] = heights.restingHeight(block, origin[1]);
+    size_t k = 0;
+    for (long iz = 0; iz < shape.counts[2]; ++iz) {
+        for (long iy = 0; iy < shape.counts[1]; ++iy) {
+            for (long ix = 0; ix < shape.counts[0]; ++ix) {
+                Item& unit = *units[k++];
+                const std::array<long, 3> at = {origin[0] + ix * d[0], origin[1] + iy * d[1], origin[2] + iz * d[2]};
+                unit.setRotationType(shape.rotation);
+                unit.setPosition({at[0], at[1], at[2]});
+                items.push_back(handleFor(unit));
+                insertBox({at, {at[0] + d[0], at[1] + d[1], at[2] + d[2]}}, unit.disablesStacking(), unit.getWeight());
+            }
         }
     }
+    // The block's faces give the same extreme points as one big item
+    updateExtremePoints({origin, {origin[0] + shape.counts[0] * d[0], origin[1] + shape.counts[1] * d[1],
+                                  origin[2] + shape.counts[2] * d[2]}});
+}
 
-    // Item fits, add it to the bin
-    items.push_back(std::ref(item));
+std::array<long, 3> Bin::roomAt(const std::tuple<long, long, long>& p) const {
+    const std::array<long, 3> at = {std::get<0>(p), std::get<1>(p), std::get<2>(p)};
+    if (isOccupied(at)) {
+        return {0, 0, 0};
+    }
+    const std::array<long, 3> extent = {getWidth(), getHeight(), getDepth()};
+    const Aabb cell = {at, {at[0] + 1, at[1] + 1, at[2] + 1}};
+    std::array<long, 3> room;
+    for (size_t axis = 0; axis < 3; ++axis) {
+        room[axis] = freeRun(cell, axis, extent[axis]) - at[axis];
+    }
+    return room;
+}
+
+bool Bin::PointRoom::admits(const Dimension& d) const {
+    if (d[0] > room[0] || d[1] > room[1] || d[2] > room[2]) {
+        return false;
+    }
+    for (uint8_t i = 0; i < blocked_count; ++i) {
+        if (d[0] >= blocked[i][0] && d[1] >= blocked[i][1] && d[2] >= blocked[i][2]) {
+            return false;
+        }
+    }
     return true;
 }
 
+void Bin::PointRoom::block(const Dimension& d) {
+    blocked[blocked_next] = d;
+    blocked_next = static_cast<uint8_t>((blocked_next + 1) % blocked.size());
+    blocked_count = static_cast<uint8_t>(std::min<size_t>(blocked_count + 1, blocked.size()));
+}
+
+bool Bin::putItemFirstFit(Item& item) {
+    // Resync up front: putItem must not rebuild the index while a room slot is held
+    if (boxes.size() != items.size()) {
+        rebuildIndex();
+    }
+    const auto& plan = getRotationPlan(item);
+    if (plan.empty()) {
+        return false;
+    }
+    if (room_bound_valid) {
+        // A box at p spans the free cell at p, so it needs at least its own
+        // size of free run from p along each axis
+        bool any = false;
+        for (auto rotation : plan) {
+            const auto d = item.getDims(rotation);
+            any = any || (d[0] <= room_bound[0] && d[1] <= room_bound[1] && d[2] <= room_bound[2]);
+        }
+        if (!any) {
+            return false;
+        }
+    }
+
+    std::array<long, 3> bound = {0, 0, 0};
+    for (size_t k = 0; k < extreme_points.size(); ++k) {
+        const auto p = extreme_points[k];
+        auto [slot, added] = point_room.try_emplace(p);
+        PointRoom& known = slot->second;
+        if (added || known.generation != room_generation) {
+            known = PointRoom{};
+            known.room = roomAt(p);
+            known.generation = room_generation;
+        }
+        for (size_t axis = 0; axis < 3; ++axis) {
+            bound[axis] = std::max(bound[axis], known.room[axis]);
+        }
+        if (item.bottomLoadOnly() && std::get<1>(p) != 0) continue;
+
+        // A collision is remembered as the smallest size that reaches the
+        // box it hit, so later items that would hit it too cost no query
+        bool may_fit = false;
+        for (auto rotation : plan) {
+            const auto d = item.getDims(rotation);
+            if (!known.admits(d)) continue;
+            const Aabb box = {{std::get<0>(p), std::get<1>(p), std::get<2>(p)},
+                              {std::get<0>(p) + d[0], std::get<1>(p) + d[1], std::get<2>(p) + d[2]}};
+            if (box.max[0] > getWidth() || box.max[1] > getHeight() || box.max[2] > getDepth()) {
+                known.block(d);
+                continue;
+            }
+            Aabb hit;
+            if (collidesWith(box, hit)) {
+                Dimension reach;
+                for (size_t axis = 0; axis < 3; ++axis) {
+                    reach[axis] = std::max(hit.min[axis] - box.min[axis], 0L) + 1;
+                }
+                known.block(reach);
+                continue;
+            }
+            may_fit = true;
+            break;
+        }
+        if (!may_fit) continue;
+        countStat(&PackStats::candidates_extreme_point);
+        if (putItem(item, p)) {
+            return true;
+        }
+    }
+    room_bound = bound;
+    room_bound_valid = true;
+    return false;
+}
+
 // Replace putItemWithGravity with this simpler version
 bool Bin::putItemWithGravity(Item& item, const std::tuple<long, long, long>& p) {
     return putItem(item, p); // We've integrated gravity into putItem
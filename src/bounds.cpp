@@ -0,0 +1,209 @@
+#include "bounds.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+// L2 is evaluated at up to this many thresholds per axis
+constexpr size_t MAX_THRESHOLDS = 16;
+
+// Units of one type: its rotations that fit the bounding bin, and how many.
+struct TypeGroup {
+    std::vector<Dimension> shapes;
+    long volume = 0;
+    size_t count = 0;
+};
+
+// Smallest whole number of bins of `capacity` holding `amount`, for
+// non-negative whole-number amounts held in doubles.
+size_t binsFor(double amount, double capacity) {
+    if (amount <= 0 || capacity <= 0) return 0;
+    return static_cast<size_t>(std::ceil((amount - 0.5) / capacity));
+}
+
+// Martello-Toth bound for one-dimensional bin packing. sizes holds (size,
+// units) pairs, each size at most capacity.
+size_t oneDimBound(std::vector<std::pair<long, size_t>> sizes, long capacity) {
+    if (sizes.empty()) return 0;
+    std::sort(sizes.begin(), sizes.end());
+    const size_t n = sizes.size();
+    std::vector<double> units(n + 1, 0), total(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        units[i + 1] = units[i] + sizes[i].second;
+        total[i + 1] = total[i] + static_cast<double>(sizes[i].first) * sizes[i].second;
+    }
+    // First entry larger than `size`
+    auto above = [&](long size) {
+        return static_cast<size_t>(std::upper_bound(sizes.begin(), sizes.end(),
+                                                    std::make_pair(size, std::numeric_limits<size_t>::max())) -
+                                   sizes.begin());
+    };
+
+    // No two units over half the capacity share a bin
+    const size_t half = above(capacity / 2);
+    const double large = units[n] - units[half];
+    size_t best = static_cast<size_t>(large);
+    // For each small size p: units over capacity - p leave no room for any
+    // unit of size p or more, the others leave their free space to them
+    for (size_t i = 0; i < half; ++i) {
+        const long p = sizes[i].first;
+        if (i > 0 && sizes[i - 1].first == p) continue;
+        const size_t crowded = above(capacity - p);
+        const double free_space = (units[crowded] - units[half]) * capacity - (total[crowded] - total[half]);
+        const double small = total[half] - total[i];
+        best = std::max(best, static_cast<size_t>(large) + binsFor(small - free_space, capacity));
+    }
+    return best;
+}
+
+// Distinct sizes along `axis` of at most half of `extent`, thinned out evenly.
+std::vector<long> thresholds(const std::vector<TypeGroup>& groups, size_t axis, long extent) {
+    std::vector<long> values;
+    for (const auto& group : groups) {
+        for (const auto& shape : group.shapes) {
+            if (shape[axis] > 0 && 2 * shape[axis] <= extent) {
+                values.push_back(shape[axis]);
+            }
+        }
+    }
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    if (values.size() <= MAX_THRESHOLDS) {
+        return values;
+    }
+    std::vector<long> picked;
+    for (size_t k = 0; k < MAX_THRESHOLDS; ++k) {
+        picked.push_back(values[k * (values.size() - 1) / (MAX_THRESHOLDS - 1)]);
+    }
+    return picked;
+}
+
+} // namespace
+
+size_t BinBounds::lower() const {
+    return std::max({volume, weight, l1, l2});
+}
+
+bool fitsAnyBin(const Item& item, const std::vector<Bin>& bins) {
+    for (const auto& bin : bins) {
+        if (bin.max_weight > 0 && item.getWeight() > bin.max_weight) continue;
+        for (RotationType rotation : item.getAllowedRotations()) {
+            const auto d = item.getDims(rotation);
+            if (d[0] <= bin.getWidth() && d[1] <= bin.getHeight() && d[2] <= bin.getDepth()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+BinBounds computeBounds(const std::vector<const Item*>& items, const std::vector<Bin>& bins) {
+    BinBounds bounds;
+    if (bins.empty()) {
+        bounds.unfit = items.size();
+        return bounds;
+    }
+
+    // A packing into k of the real bins is also one into k bins this large
+    Dimension extent = {0, 0, 0};
+    double largest_volume = 0;
+    double weight_limit = 0;
+    bool weight_bounded = true;
+    for (const auto& bin : bins) {
+        extent[0] = std::max(extent[0], bin.getWidth());
+        extent[1] = std::max(extent[1], bin.getHeight());
+        extent[2] = std::max(extent[2], bin.getDepth());
+        largest_volume = std::max(largest_volume, static_cast<double>(bin.getVolume()));
+        weight_bounded = weight_bounded && bin.max_weight > 0;
+        weight_limit = std::max(weight_limit, static_cast<double>(bin.max_weight));
+    }
+
+    // Units of one type bound the same way; do the work once per type
+    std::vector<TypeGroup> groups;
+    std::unordered_map<const ItemType*, size_t> group_of;
+    double total_volume = 0;
+    double total_weight = 0;
+    for (const Item* item : items) {
+        auto [slot, added] = group_of.try_emplace(&item->getType(), groups.size());
+        if (added) {
+            TypeGroup group;
+            if (fitsAnyBin(*item, bins)) {
+                for (RotationType rotation : item->getAllowedRotations()) {
+                    const auto d = item->getDims(rotation);
+                    if (d[0] <= extent[0] && d[1] <= extent[1] && d[2] <= extent[2]) {
+                        group.shapes.push_back(d);
+                    }
+                }
+            }
+            group.volume = item->getVolume();
+            groups.push_back(std::move(group));
+        }
+        TypeGroup& group = groups[slot->second];
+        if (group.shapes.empty()) {
+            ++bounds.unfit;
+            continue;
+        }
+        ++group.count;
+        total_volume += group.volume;
+        total_weight += item->getWeight();
+    }
+    groups.erase(std::remove_if(groups.begin(), groups.end(), [](const TypeGroup& group) { return group.count == 0; }),
+                 groups.end());
+
+    bounds.volume = binsFor(total_volume, largest_volume);
+    if (weight_bounded && total_weight > 0) {
+        bounds.weight = static_cast<size_t>(std::ceil(total_weight / weight_limit - 1e-9));
+    }
+
+    const double bin_volume = static_cast<double>(extent[0]) * extent[1] * extent[2];
+    // Each pair of axes in turn, with the stacking axis last
+    for (const auto& [a, b, c] : {std::array<size_t, 3>{0, 1, 2}, {0, 2, 1}, {1, 2, 0}}) {
+        // Units over half the bin along a and b in every rotation form one stack along c
+        std::vector<std::pair<long, size_t>> stack;
+        for (const auto& group : groups) {
+            long least = std::numeric_limits<long>::max();
+            bool large = true;
+            for (const auto& d : group.shapes) {
+                large = large && 2 * d[a] > extent[a] && 2 * d[b] > extent[b];
+                least = std::min(least, d[c]);
+            }
+            if (large) {
+                stack.emplace_back(least, group.count);
+            }
+        }
+        const size_t l1 = oneDimBound(std::move(stack), extent[c]);
+        bounds.l1 = std::max(bounds.l1, l1);
+
+        // Units over extent - p along a and over extent - q along b take
+        // their whole column from units that are at least p by q, and from
+        // units over half the bin; count each unit in its cheapest rotation
+        size_t l2 = l1;
+        const auto ps = thresholds(groups, a, extent[a]);
+        const auto qs = thresholds(groups, b, extent[b]);
+        for (long p : ps) {
+            for (long q : qs) {
+                double column = 0;
+                for (const auto& group : groups) {
+                    double least = std::numeric_limits<double>::max();
+                    for (const auto& d : group.shapes) {
+                        double part = 0;
+                        if (d[a] > extent[a] - p && d[b] > extent[b] - q) {
+                            part = static_cast<double>(d[c]) * extent[a] * extent[b];
+                        } else if ((2 * d[a] > extent[a] && 2 * d[b] > extent[b]) || (d[a] >= p && d[b] >= q)) {
+                            part = static_cast<double>(group.volume);
+                        }
+                        least = std::min(least, part);
+                    }
+                    column += least * group.count;
+                }
+                l2 = std::max(l2, binsFor(column, bin_volume));
+            }
+        }
+        bounds.l2 = std::max(bounds.l2, l2);
+    }
+    return bounds;
+}
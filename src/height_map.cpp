@@ -0,0 +1,210 @@
+#include "height_map.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Cells about the size of an item footprint; no axis split more than 64 ways.
+constexpr double TARGET_CELLS = 256.0;
+constexpr long MAX_CELLS_PER_AXIS = 64;
+}
+
+void HeightMap::reset(long width, long depth) {
+    extent_ = {width, depth};
+    const std::array<long, 2> dims = {std::max(1L, width), std::max(1L, depth)};
+    const double area = static_cast<double>(dims[0]) * dims[1];
+    const long edge = std::max(1L, static_cast<long>(std::ceil(std::sqrt(area / TARGET_CELLS))));
+
+    for (size_t axis = 0; axis < 2; ++axis) {
+        cell_count_[axis] = std::min(MAX_CELLS_PER_AXIS, (dims[axis] + edge - 1) / edge);
+        cell_size_[axis] = (dims[axis] + cell_count_[axis] - 1) / cell_count_[axis];
+    }
+    cells_.assign(cell_count_[0] * cell_count_[1], {});
+    clear();
+}
+
+void HeightMap::clear() {
+    for (auto& cell : cells_) {
+        cell.top = 0;
+        cell.lowest_bottom = -1;
+        cell.highest_blocked = -1;
+        cell.ids.clear();
+    }
+    for (auto* column : {&min_x_, &max_x_, &min_z_, &max_z_, &bottom_, &top_}) {
+        column->clear();
+    }
+    disable_stacking_.clear();
+}
+
+bool HeightMap::cellRange(const Aabb& box, std::array<long, 2>& lo, std::array<long, 2>& hi) const {
+    if (cells_.empty() || box.max[0] <= box.min[0] || box.max[2] <= box.min[2]) {
+        return false;
+    }
+    const std::array<long, 2> min = {box.min[0], box.min[2]};
+    const std::array<long, 2> max = {box.max[0], box.max[2]};
+    for (size_t axis = 0; axis < 2; ++axis) {
+        lo[axis] = std::clamp(min[axis] / cell_size_[axis], 0L, cell_count_[axis] - 1);
+        hi[axis] = std::clamp((max[axis] - 1) / cell_size_[axis], 0L, cell_count_[axis] - 1);
+    }
+    return true;
+}
+
+size_t HeightMap::cellOf(long x, long z) const {
+    const long cx = std::clamp(x / cell_size_[0], 0L, cell_count_[0] - 1);
+    const long cz = std::clamp(z / cell_size_[1], 0L, cell_count_[1] - 1);
+    return static_cast<size_t>(cz * cell_count_[0] + cx);
+}
+
+bool HeightMap::overlapsFootprint(uint32_t id, const Aabb& box) const {
+    return min_x_[id] < box.max[0] && box.min[0] < max_x_[id] &&
+           min_z_[id] < box.max[2] && box.min[2] < max_z_[id];
+}
+
+void HeightMap::insert(const Aabb& box, bool disable_stacking) {
+    const auto id = static_cast<uint32_t>(bottom_.size());
+    min_x_.push_back(box.min[0]);
+    max_x_.push_back(box.max[0]);
+    min_z_.push_back(box.min[2]);
+    max_z_.push_back(box.max[2]);
+    bottom_.push_back(box.min[1]);
+    top_.push_back(box.max[1]);
+    disable_stacking_.push_back(disable_stacking ? 1 : 0);
+
+    std::array<long, 2> lo, hi;
+    if (!cellRange(box, lo, hi)) {
+        return;
+    }
+    for (long cz = lo[1]; cz <= hi[1]; ++cz) {
+        for (long cx = lo[0]; cx <= hi[0]; ++cx) {
+            Cell& cell = cells_[cz * cell_count_[0] + cx];
+            cell.top = std::max(cell.top, box.max[1]);
+            cell.lowest_bottom = cell.lowest_bottom < 0 ? box.min[1] : std::min(cell.lowest_bottom, box.min[1]);
+            if (disable_stacking) {
+                cell.highest_blocked = std::max(cell.highest_blocked, box.min[1]);
+            }
+            cell.ids.push_back(id);
+        }
+    }
+}
+
+void HeightMap::removeLast() {
+    if (bottom_.empty()) {
+        return;
+    }
+    const auto id = static_cast<uint32_t>(bottom_.size() - 1);
+    const Aabb box = {{min_x_[id], bottom_[id], min_z_[id]}, {max_x_[id], top_[id], max_z_[id]}};
+    for (auto* column : {&min_x_, &max_x_, &min_z_, &max_z_, &bottom_, &top_}) {
+        column->pop_back();
+    }
+    disable_stacking_.pop_back();
+
+    std::array<long, 2> lo, hi;
+    if (!cellRange(box, lo, hi)) {
+        return;
+    }
+    for (long cz = lo[1]; cz <= hi[1]; ++cz) {
+        for (long cx = lo[0]; cx <= hi[0]; ++cx) {
+            Cell& cell = cells_[cz * cell_count_[0] + cx];
+            if (!cell.ids.empty() && cell.ids.back() == id) {
+                cell.ids.pop_back();
+            }
+            // Maxima cannot be undone in place; recount from the boxes left
+            cell.top = 0;
+            cell.lowest_bottom = -1;
+            cell.highest_blocked = -1;
+            for (uint32_t other : cell.ids) {
+                cell.top = std::max(cell.top, top_[other]);
+                cell.lowest_bottom = cell.lowest_bottom < 0 ? bottom_[other] : std::min(cell.lowest_bottom, bottom_[other]);
+                if (disable_stacking_[other]) {
+                    cell.highest_blocked = std::max(cell.highest_blocked, bottom_[other]);
+                }
+            }
+        }
+    }
+}
+
+long HeightMap::restingHeight(const Aabb& box, long y) const {
+    std::array<long, 2> lo, hi;
+    if (y <= 0 || !cellRange(box, lo, hi)) {
+        return 0;
+    }
+    long rest = 0;
+    for (long cz = lo[1]; cz <= hi[1]; ++cz) {
+        for (long cx = lo[0]; cx <= hi[0]; ++cx) {
+            const Cell& cell = cells_[cz * cell_count_[0] + cx];
+            // Nothing in this cell can beat the best surface found so far
+            if (cell.lowest_bottom < 0 || cell.top <= rest) continue;
+            for (uint32_t id : cell.ids) {
+                if (top_[id] <= y && top_[id] > rest && overlapsFootprint(id, box)) {
+                    rest = top_[id];
+                    if (rest == y) return rest;
+                }
+            }
+        }
+    }
+    return rest;
+}
+
+double HeightMap::supportedFraction(const Aabb& box) const {
+    const long y = box.min[1];
+    const double area = static_cast<double>(box.max[0] - box.min[0]) * (box.max[2] - box.min[2]);
+    if (y <= 0 || area <= 0) {
+        return 1.0;
+    }
+    std::array<long, 2> lo, hi;
+    if (!cellRange(box, lo, hi)) {
+        return 0.0;
+    }
+    // Tops at one height never overlap, so the supported area is a plain sum.
+    // Each box is counted in the cell holding the near corner of its overlap.
+    double supported = 0;
+    for (long cz = lo[1]; cz <= hi[1]; ++cz) {
+        for (long cx = lo[0]; cx <= hi[0]; ++cx) {
+            const size_t here = static_cast<size_t>(cz * cell_count_[0] + cx);
+            const Cell& cell = cells_[here];
+            if (cell.lowest_bottom < 0 || cell.top < y) continue;
+            for (uint32_t id : cell.ids) {
+                if (top_[id] != y || !overlapsFootprint(id, box)) continue;
+                const long x0 = std::max(min_x_[id], box.min[0]);
+                const long z0 = std::max(min_z_[id], box.min[2]);
+                if (cellOf(x0, z0) != here) continue;
+                supported += static_cast<double>(std::min(max_x_[id], box.max[0]) - x0) *
+                             (std::min(max_z_[id], box.max[2]) - z0);
+            }
+        }
+    }
+    return std::min(1.0, supported / area);
+}
+
+bool HeightMap::anyBelow(const Aabb& box, long y) const {
+    std::array<long, 2> lo, hi;
+    if (!cellRange(box, lo, hi)) {
+        return false;
+    }
+    for (long cz = lo[1]; cz <= hi[1]; ++cz) {
+        for (long cx = lo[0]; cx <= hi[0]; ++cx) {
+            const Cell& cell = cells_[cz * cell_count_[0] + cx];
+            if (cell.lowest_bottom < 0 || cell.lowest_bottom >= y) continue;
+            for (uint32_t id : cell.ids) {
+                if (bottom_[id] < y && overlapsFootprint(id, box)) return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool HeightMap::stackingBlockedAbove(const Aabb& box, long y) const {
+    std::array<long, 2> lo, hi;
+    if (!cellRange(box, lo, hi)) {
+        return false;
+    }
+    for (long cz = lo[1]; cz <= hi[1]; ++cz) {
+        for (long cx = lo[0]; cx <= hi[0]; ++cx) {
+            const Cell& cell = cells_[cz * cell_count_[0] + cx];
+            if (cell.highest_blocked <= y) continue;
+            for (uint32_t id : cell.ids) {
+                if (disable_stacking_[id] && bottom_[id] > y && overlapsFootprint(id, box)) return true;
+            }
+        }
+    }
+    return false;
+}
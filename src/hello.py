@@ -8,12 +8,9 @@ import time
 
 packer = pybinding.Packer()
 packer.add_bin(pybinding.Bin('Le grande box', 2500, 2650, 13600))
-for i in range(80):
-    packer.add_item(pybinding.Item(f'Bag {i}', 500, 400, 300))
-for i in range(100):
-    packer.add_item(pybinding.Item(f'Sack {i}', 1000, 450, 300))
-for i in range(150):
-    packer.add_item(pybinding.Item(f'Box {i}', 1000, 1000, 1000))
+packer.add_item_type([500, 400, 300], quantity=80, name='Bag')
+packer.add_item_type([1000, 450, 300], quantity=100, name='Sack')
+packer.add_item_type([1000, 1000, 1000], quantity=150, name='Box')
 
 start = time.time()
 packer.pack()
@@ -1,35 +1,95 @@
 #include "item.h"
+#include "utils.h"
 #include <iostream>
 
+bool ItemType::operator==(const ItemType& other) const {
+    return name == other.name && color == other.color &&
+           width == other.width && height == other.height && depth == other.depth &&
+           allowed_rotations == other.allowed_rotations && weight == other.weight &&
+           stuffing_height == other.stuffing_height &&
+           stuffing_max_weight == other.stuffing_max_weight &&
+           stuffing_layers == other.stuffing_layers &&
+           bottom_load_only == other.bottom_load_only && disable_stacking == other.disable_stacking;
+}
+
+size_t ItemTypeHash::operator()(const ItemType& type) const {
+    size_t h = std::hash<std::string>()(type.name);
+    h = h * 31 + std::hash<std::string>()(type.color);
+    h = h * 31 + std::hash<long>()(type.width);
+    h = h * 31 + std::hash<long>()(type.height);
+    h = h * 31 + std::hash<long>()(type.depth);
+    for (auto rotation : type.allowed_rotations) {
+        h = h * 7 + static_cast<size_t>(rotation);
+    }
+    h = h * 31 + std::hash<float>()(type.weight);
+    return h * 4 + type.bottom_load_only * 2 + type.disable_stacking;
+}
+
 // Update constructor with new parameters
 Item::Item(const std::string& name, long w, long h, long d,
            const std::vector<RotationType>& allowed_rotations,
            const std::string& color, float weight,
            int stuffing_height, float stuffing_max_weight, 
            int stuffing_layers, bool bottom_load_only, 
-           bool disable_stacking)
-    : Box(name, w, h, d),
-      _allowed_rotations(allowed_rotations.empty() ? std::vector<RotationType>{
-          RotationType::whd,
-          RotationType::hwd,
-          RotationType::hdw,
-          RotationType::dhw,
-          RotationType::dwh,
-          RotationType::wdh
-      } : allowed_rotations),
-      _rotation_type(_allowed_rotations[0]),
-      color(color.empty() ? "#000000" : color),
-      weight(weight),
-      stuffing_height(stuffing_height),
-      stuffing_max_weight(stuffing_max_weight),
-      stuffing_layers(stuffing_layers),
-      bottom_load_only(bottom_load_only),
-      disable_stacking(disable_stacking) {
+           bool disable_stacking) {
+    auto owned = std::make_shared<ItemType>();
+    owned->name = name;
+    owned->color = color.empty() ? "#000000" : color;
+    owned->width = factored_integer(w);
+    owned->height = factored_integer(h);
+    owned->depth = factored_integer(d);
+    owned->allowed_rotations = allowed_rotations.empty() ? std::vector<RotationType>{
+        RotationType::whd,
+        RotationType::hwd,
+        RotationType::hdw,
+        RotationType::dhw,
+        RotationType::dwh,
+        RotationType::wdh
+    } : allowed_rotations;
+    owned->weight = weight;
+    owned->stuffing_height = stuffing_height;
+    owned->stuffing_max_weight = stuffing_max_weight;
+    owned->stuffing_layers = stuffing_layers;
+    owned->bottom_load_only = bottom_load_only;
+    owned->disable_stacking = disable_stacking;
+    type = std::move(owned);
+    _rotation_type = type->allowed_rotations[0];
     _position = std::tuple<long, long, long>{0, 0, 0};
 }
 
+Item::Item(std::shared_ptr<const ItemType> type)
+    : _position{0, 0, 0}, _rotation_type(type->allowed_rotations[0]), type(std::move(type)) {}
+
+void Item::setType(std::shared_ptr<const ItemType> type) {
+    this->type = std::move(type);
+}
+
+ItemType& Item::mutableType() {
+    // Copy on write: other items of this type keep the old data
+    if (type.use_count() > 1) {
+        type = std::make_shared<ItemType>(*type);
+    }
+    return const_cast<ItemType&>(*type);
+}
+
+void Item::setName(const std::string& name) { mutableType().name = name; }
+void Item::setWidth(long width) { mutableType().width = width; }
+void Item::setHeight(long height) { mutableType().height = height; }
+void Item::setDepth(long depth) { mutableType().depth = depth; }
+void Item::setColor(const std::string& color) { mutableType().color = color; }
+void Item::setWeight(float weight) { mutableType().weight = weight; }
+void Item::setStuffingHeight(int stuffing_height) { mutableType().stuffing_height = stuffing_height; }
+void Item::setStuffingMaxWeight(float stuffing_max_weight) { mutableType().stuffing_max_weight = stuffing_max_weight; }
+void Item::setStuffingLayers(int stuffing_layers) { mutableType().stuffing_layers = stuffing_layers; }
+void Item::setBottomLoadOnly(bool bottom_load_only) { mutableType().bottom_load_only = bottom_load_only; }
+void Item::setDisableStacking(bool disable_stacking) { mutableType().disable_stacking = disable_stacking; }
+
+void Item::setAllowedRotations(const std::vector<RotationType>& rotations) {
+    mutableType().allowed_rotations = rotations;
+}
+
 const std::vector<RotationType>& Item::getAllowedRotations() const {
-    return _allowed_rotations;
+    return type->allowed_rotations;
 }
 
 RotationType Item::getRotationType() const {
@@ -52,45 +112,48 @@ std::string Item::getRotationTypeString() const {
     return ROTATION_TYPE_STRINGS.at(_rotation_type);
 }
 
-std::vector<long> Item::getDimension() const {
-    switch (_rotation_type) {
+Dimension Item::getDims() const {
+    return getDims(_rotation_type);
+}
+
+Dimension Item::getDims(RotationType rotation) const {
+    const long w = type->width, h = type->height, d = type->depth;
+    switch (rotation) {
         case RotationType::whd:
-            return {width, height, depth};
+            return {w, h, d};
         case RotationType::hwd:
-            return {height, width, depth};
+            return {h, w, d};
         case RotationType::hdw:
-            return {height, depth, width};
+            return {h, d, w};
         case RotationType::dhw:
-            return {depth, height, width};
+            return {d, h, w};
         case RotationType::dwh:
-            return {depth, width, height};
+            return {d, w, h};
         case RotationType::wdh:
-            return {width, depth, height};
+            return {w, d, h};
         default:
-            return {width, height, depth};
+            return {w, h, d};
     }
 }
 
-template <size_t X, size_t Y>
-bool rectIntersectImpl(const Item& item1, const Item& item2) {
-    const auto& d1 = item1.getDimension();
-    const auto& d2 = item2.getDimension();
-    const auto& p1 = item1.getPosition();
-    const auto& p2 = item2.getPosition();
-
-    // Calculate center points using position and dimensions
-    float cx1 = std::get<X>(p1) + d1[X] / 2.0f;
-    float cy1 = std::get<Y>(p1) + d1[Y] / 2.0f;
-    float cx2 = std::get<X>(p2) + d2[X] / 2.0f;
-    float cy2 = std::get<Y>(p2) + d2[Y] / 2.0f;
+std::vector<long> Item::getDimension() const {
+    const auto d = getDims();
+    return {d[0], d[1], d[2]};
+}
 
-    // Calculate intersection distances using max-min
-    float ix = std::max(cx1, cx2) - std::min(cx1, cx2);
-    float iy = std::max(cy1, cy2) - std::min(cy1, cy2);
+Aabb Item::getBounds() const {
+    const auto d = getDims();
+    const auto& [x, y, z] = _position;
+    return {{x, y, z}, {x + d[0], y + d[1], z + d[2]}};
+}
 
-    // Check if boxes overlap in both dimensions
-    return ix < (d1[X] + d2[X]) / 2.0f && 
-           iy < (d1[Y] + d2[Y]) / 2.0f;
+template <size_t X, size_t Y>
+bool rectIntersectImpl(const Item& item1, const Item& item2) {
+    // Exact integer overlap of the two projected rectangles
+    const Aabb b1 = item1.getBounds();
+    const Aabb b2 = item2.getBounds();
+    return b1.min[X] < b2.max[X] && b2.min[X] < b1.max[X] &&
+           b1.min[Y] < b2.max[Y] && b2.min[Y] < b1.max[Y];
 }
 
 bool rectIntersect(const Item& item1, const Item& item2, Axis x, Axis y) {
@@ -105,11 +168,8 @@ bool rectIntersect(const Item& item1, const Item& item2, Axis x, Axis y) {
 }
 
 bool Item::doesIntersect(const Item& other) const {
-    // Check intersection in all three planes
-    bool xy = rectIntersect(*this, other, Axis::width, Axis::height);
-    bool yz = rectIntersect(*this, other, Axis::height, Axis::depth);
-    bool xz = rectIntersect(*this, other, Axis::width, Axis::depth);
-    return xy && yz && xz;
+    // Overlapping in all three planes is the same as the boxes overlapping
+    return getBounds().overlaps(other.getBounds());
 }
 
 bool Item::operator==(const Item& other) const {
@@ -117,8 +177,8 @@ bool Item::operator==(const Item& other) const {
 }
 
 std::ostream& operator<<(std::ostream& os, const Item& item) {
-    os << "Item: " << item.name << " (" << item.getRotationTypeString() << " = ";
-    const auto& dim = item.getDimension();
+    os << "Item: " << item.type->name << " (" << item.getRotationTypeString() << " = ";
+    const auto dim = item.getDims();
     os << dim[0] << " x " << dim[1] << " x " << dim[2] << ")";
     return os;
 }
\ No newline at end of file
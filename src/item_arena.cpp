@@ -0,0 +1,81 @@
+#include "item_arena.h"
+#include <utility>
+
+ItemArena::ItemArena(const ItemArena& other) {
+    reserve(other.count);
+    for (const auto& item : other) {
+        add(item);
+    }
+}
+
+ItemArena::ItemArena(ItemArena&& other) noexcept
+    : chunks(std::move(other.chunks)), count(other.count), constructed(other.constructed) {
+    other.chunks.clear();
+    other.count = 0;
+    other.constructed = 0;
+}
+
+ItemArena& ItemArena::operator=(const ItemArena& other) {
+    if (this != &other) {
+        clear();
+        reserve(other.count);
+        for (const auto& item : other) {
+            add(item);
+        }
+    }
+    return *this;
+}
+
+ItemArena& ItemArena::operator=(ItemArena&& other) noexcept {
+    if (this != &other) {
+        destroy();
+        chunks = std::move(other.chunks);
+        count = other.count;
+        constructed = other.constructed;
+        other.chunks.clear();
+        other.count = 0;
+        other.constructed = 0;
+    }
+    return *this;
+}
+
+ItemArena::~ItemArena() {
+    destroy();
+}
+
+void ItemArena::destroy() {
+    for (size_t i = 0; i < constructed; ++i) {
+        slot(i)->~Item();
+    }
+    chunks.clear();
+    count = 0;
+    constructed = 0;
+}
+
+void ItemArena::reserve(size_t capacity) {
+    while (chunks.size() * CHUNK_SIZE < capacity) {
+        chunks.push_back(std::make_unique<Chunk>());
+    }
+}
+
+template <typename T>
+ItemHandle ItemArena::emplace(T&& item) {
+    if (count < constructed) {
+        // Reuse a slot left by clear(), already constructed
+        *slot(count) = std::forward<T>(item);
+    } else {
+        reserve(count + 1);
+        new (chunks[count >> CHUNK_BITS]->storage + sizeof(Item) * (count & (CHUNK_SIZE - 1)))
+            Item(std::forward<T>(item));
+        ++constructed;
+    }
+    return static_cast<ItemHandle>(count++);
+}
+
+ItemHandle ItemArena::add(const Item& item) {
+    return emplace(item);
+}
+
+ItemHandle ItemArena::add(Item&& item) {
+    return emplace(std::move(item));
+}
@@ -1,14 +1,228 @@
 #include "log.h"
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
 
-bool is_log_enabled = false;
+std::atomic<bool> is_log_enabled{false};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t RING_CAPACITY = 1024;
+constexpr auto WRITER_INTERVAL = std::chrono::milliseconds(5);
+
+// Single producer (the owning thread), single consumer (whoever holds the
+// drain lock). head and tail only grow; slots are indexed modulo capacity.
+struct LogRing {
+    std::array<LogRecord, RING_CAPACITY> records;
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    std::atomic<bool> retired{false};
+    uint32_t thread = 0;
+};
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::debug: return "DEBUG";
+        case LogLevel::info: return "INFO";
+        case LogLevel::warn: return "WARN";
+        case LogLevel::error: return "ERROR";
+    }
+    return "LOG";
+}
+
+class LogWriter {
+public:
+    ~LogWriter() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            stop = true;
+        }
+        wake.notify_one();
+        if (writer.joinable()) {
+            writer.join();
+        }
+        drain();
+    }
+
+    std::shared_ptr<LogRing> registerThread() {
+        auto ring = std::make_shared<LogRing>();
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        ring->thread = next_thread++;
+        rings.push_back(ring);
+        if (!writer.joinable()) {
+            writer = std::thread([this]() { run(); });
+        }
+        return ring;
+    }
+
+    void push(LogRing& ring, const LogRecord& record) {
+        const size_t head = ring.head.load(std::memory_order_relaxed);
+        const size_t tail = ring.tail.load(std::memory_order_acquire);
+        if (head - tail >= RING_CAPACITY) {
+            // Never block the caller; the writer is behind
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        LogRecord& slot = ring.records[head % RING_CAPACITY];
+        slot = record;
+        slot.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        slot.thread = ring.thread;
+        slot.sequence = head;
+        ring.head.store(head + 1, std::memory_order_release);
+        if (head - tail == RING_CAPACITY / 2) {
+            wake.notify_one();
+        }
+    }
+
+    void drain() {
+        std::lock_guard<std::mutex> drain_lock(drain_mutex);
+        drainLocked();
+    }
+
+    void setOutput(std::FILE* out) {
+        // Under the drain lock so no batch is written to a stream being swapped out
+        std::lock_guard<std::mutex> drain_lock(drain_mutex);
+        drainLocked();
+        output = out;
+    }
+
+    std::atomic<uint64_t> dropped{0};
+
+private:
+    void drainLocked() {
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            snapshot.assign(rings.begin(), rings.end());
+        }
+
+        batch.clear();
+        for (const auto& ring : snapshot) {
+            const size_t tail = ring->tail.load(std::memory_order_relaxed);
+            const size_t head = ring->head.load(std::memory_order_acquire);
+            for (size_t i = tail; i < head; ++i) {
+                batch.push_back(ring->records[i % RING_CAPACITY]);
+            }
+            ring->tail.store(head, std::memory_order_release);
+        }
+        snapshot.clear();
+
+        {
+            // Rings of finished threads go once everything they queued is out
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            rings.erase(std::remove_if(rings.begin(), rings.end(), [](const auto& ring) {
+                            return ring->retired.load(std::memory_order_acquire) &&
+                                   ring->tail.load(std::memory_order_relaxed) ==
+                                       ring->head.load(std::memory_order_acquire);
+                        }),
+                        rings.end());
+        }
+        if (batch.empty()) {
+            return;
+        }
+
+        // std::sort, unlike stable_sort, needs no temporary buffer
+        std::sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+            return std::tie(a.timestamp_ns, a.thread, a.sequence) < std::tie(b.timestamp_ns, b.thread, b.sequence);
+        });
+        for (const auto& record : batch) {
+            write(output, record);
+        }
+        std::fflush(output);
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        while (!stop) {
+            wake.wait_for(lock, WRITER_INTERVAL);
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    }
+
+    static void write(std::FILE* out, const LogRecord& record) {
+        std::fprintf(out, "%s: %s %s", levelName(record.level), record.ns, record.event);
+        for (size_t i = 0; i < record.field_count; ++i) {
+            const LogField& field = record.fields[i];
+            switch (field.type) {
+                case LogField::Type::integer:
+                    std::fprintf(out, " %s=%lld", field.key, static_cast<long long>(field.value.integer));
+                    break;
+                case LogField::Type::real:
+                    std::fprintf(out, " %s=%g", field.key, field.value.real);
+                    break;
+                case LogField::Type::text:
+                    std::fprintf(out, " %s=%s", field.key, field.value.text);
+                    break;
+            }
+        }
+        std::fprintf(out, " thread=%u t=%.6f\n", record.thread, record.timestamp_ns * 1e-9);
+    }
+
+    const Clock::time_point start = Clock::now();
+
+    std::mutex rings_mutex;
+    std::vector<std::shared_ptr<LogRing>> rings;
+    uint32_t next_thread = 0;
+
+    std::mutex drain_mutex;
+    // Only touched under drain_mutex; kept so a steady drain does not allocate
+    std::vector<std::shared_ptr<LogRing>> snapshot;
+    std::vector<LogRecord> batch;
+    std::FILE* output = stdout;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    bool stop = false;
+    std::thread writer;
+};
+
+LogWriter& logWriter() {
+    static LogWriter instance;
+    return instance;
+}
+
+// Marks the thread's ring retired on exit; the writer frees it once drained.
+struct ThreadRing {
+    std::shared_ptr<LogRing> ring;
+    ~ThreadRing() {
+        if (ring) {
+            ring->retired.store(true, std::memory_order_release);
+        }
+    }
+};
+
+} // namespace
 
 void enable_log(bool enable) {
-    is_log_enabled = enable;
+    is_log_enabled.store(enable, std::memory_order_relaxed);
+}
+
+void set_log_output(std::FILE* out) {
+    logWriter().setOutput(out ? out : stdout);
+}
+
+void flush_log() {
+    logWriter().drain();
+}
+
+uint64_t dropped_log_records() {
+    return logWriter().dropped.load(std::memory_order_relaxed);
 }
 
-void log(const std::string& ns, const std::string& message) {
-    if (is_log_enabled) {
-        std::cout << "DEBUG: " << ns << " " << message << std::endl;
+void submit_log(const LogRecord& record) {
+    LogWriter& writer = logWriter();
+    thread_local ThreadRing local;
+    if (!local.ring) {
+        local.ring = writer.registerThread();
     }
+    writer.push(*local.ring, record);
 }
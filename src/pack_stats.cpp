@@ -0,0 +1,29 @@
+#include "pack_stats.h"
+
+void PackStats::merge(const PackStats& other) {
+    put_attempts += other.put_attempts;
+    put_accepted += other.put_accepted;
+    rejected_out_of_bounds += other.rejected_out_of_bounds;
+    rejected_bottom_load_only += other.rejected_bottom_load_only;
+    rejected_disable_stacking += other.rejected_disable_stacking;
+    rejected_overlap += other.rejected_overlap;
+    rejected_unsupported += other.rejected_unsupported;
+    rejected_overweight += other.rejected_overweight;
+    rejected_off_balance += other.rejected_off_balance;
+    candidates_start += other.candidates_start;
+    candidates_extreme_point += other.candidates_extreme_point;
+    blocks_placed += other.blocks_placed;
+    block_units += other.block_units;
+    bins_tried += other.bins_tried;
+    bin_trials += other.bin_trials;
+    packs_run += other.packs_run;
+    prefiltered_unfit += other.prefiltered_unfit;
+    improve_moves += other.improve_moves;
+    improve_accepted += other.improve_accepted;
+    improve_best += other.improve_best;
+    seconds_ordering += other.seconds_ordering;
+    seconds_bin_selection += other.seconds_bin_selection;
+    seconds_packing += other.seconds_packing;
+    seconds_improving += other.seconds_improving;
+    seconds_total += other.seconds_total;
+}
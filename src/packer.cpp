@@ -1,40 +1,286 @@
 #include "packer.h"
+#include "log.h"
+#include "thread_pool.h"
 #include <algorithm> 
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include <functional>
 #include <limits>  // Add this include for std::numeric_limits
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
 
 const std::tuple<long, long, long> START_POSITION = {0, 0, 0};
 
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
 Packer::Packer() {}
 
+Packer::Packer(const Packer& other)
+    : items(other.items), bins(other.bins), unfit_items(other.unfit_items), item_types(other.item_types),
+      options(other.options), pack_stats(other.pack_stats), type_index(other.type_index),
+      pack_truncated(other.pack_truncated) {
+    attachBins();
+}
+
+Packer::Packer(Packer&& other) noexcept
+    : items(std::move(other.items)), bins(std::move(other.bins)), unfit_items(std::move(other.unfit_items)),
+      item_types(std::move(other.item_types)), options(std::move(other.options)), pack_stats(other.pack_stats),
+      type_index(std::move(other.type_index)), pack_truncated(other.pack_truncated) {
+    attachBins();
+}
+
+Packer& Packer::operator=(const Packer& other) {
+    if (this != &other) {
+        items = other.items;
+        bins = other.bins;
+        unfit_items = other.unfit_items;
+        item_types = other.item_types;
+        options = other.options;
+        pack_stats = other.pack_stats;
+        type_index = other.type_index;
+        pack_truncated = other.pack_truncated;
+        attachBins();
+    }
+    return *this;
+}
+
+Packer& Packer::operator=(Packer&& other) noexcept {
+    if (this != &other) {
+        items = std::move(other.items);
+        bins = std::move(other.bins);
+        unfit_items = std::move(other.unfit_items);
+        item_types = std::move(other.item_types);
+        options = std::move(other.options);
+        pack_stats = other.pack_stats;
+        type_index = std::move(other.type_index);
+        pack_truncated = other.pack_truncated;
+        attachBins();
+    }
+    return *this;
+}
+
+void Packer::attachBins() {
+    for (auto& bin : bins) {
+        bin.attach(&items);
+    }
+}
+
 const std::vector<Bin>& Packer::getBins() const {
     return bins;
 }
 
-const std::vector<Item>& Packer::getItems() const {
+const ItemArena& Packer::getItems() const {
     return items;
 }
 
-const std::vector<Item>& Packer::getUnfitItems() const {
-    return unfit_items;
+std::vector<std::reference_wrapper<const Item>> Packer::getUnfitItems() const {
+    std::vector<std::reference_wrapper<const Item>> unfit;
+    unfit.reserve(unfit_items.size());
+    for (auto handle : unfit_items) {
+        unfit.push_back(std::cref(items[handle]));
+    }
+    return unfit;
+}
+
+const PackStats& Packer::stats() const {
+    return pack_stats;
+}
+
+bool Packer::truncated() const {
+    return pack_truncated;
+}
+
+BinBounds Packer::bounds() const {
+    std::vector<const Item*> item_ptrs;
+    item_ptrs.reserve(items.size());
+    for (const auto& item : items) {
+        item_ptrs.push_back(&item);
+    }
+    return computeBounds(item_ptrs, bins);
+}
+
+const BinBounds& Packer::packBounds() const {
+    if (!pack_bounds) {
+        pack_bounds = bounds();
+    }
+    return *pack_bounds;
+}
+
+bool Packer::reachesBound() const {
+    if (unfit_items.size() > packBounds().unfit) {
+        return false;
+    }
+    // The bound counts bins; fill ratio also depends on which ones are used
+    if (options.objective == PackObjective::fill_ratio) {
+        for (const auto& bin : bins) {
+            if (bin.getVolume() != bins.front().getVolume()) return false;
+        }
+    }
+    size_t used = 0;
+    for (const auto& bin : bins) {
+        used += bin.itemCount() > 0 ? 1 : 0;
+    }
+    return used <= packBounds().lower();
+}
+
+bool Packer::outOfTime() {
+    if (stopped) {
+        return true;
+    }
+    if (options.cancel_token.cancelled()) {
+        return stopped = true;
+    }
+    // The loops around the checks are short, so the clock is only read every few
+    constexpr uint32_t CLOCK_EVERY = 16;
+    if (options.deadline != Clock::time_point::max() && ++stop_checks % CLOCK_EVERY == 0 &&
+        Clock::now() >= options.deadline) {
+        stopped = true;
+    }
+    return stopped;
+}
+
+Packer Packer::cloneProblem() const {
+    Packer clone;
+    clone.items = items;
+    for (auto& item : clone.items) {
+        item.setPosition(START_POSITION);
+    }
+    clone.bins = bins;
+    clone.attachBins();
+    // Items point at the shared types, so the index keys stay valid in the clone
+    clone.item_types = item_types;
+    clone.type_index = type_index;
+    for (auto& bin : clone.bins) {
+        bin.setItems({});
+    }
+    return clone;
+}
+
+void Packer::reset() {
+    items.clear();
+    unfit_items.clear();
+    item_types.clear();
+    type_index.clear();
+    for (auto& bin : bins) {
+        bin.setItems({});
+    }
+    pack_stats = PackStats{};
+    pack_truncated = false;
 }
 
 void Packer::addBin(const Bin& bin) {
     bins.push_back(bin);
+    bins.back().attach(&items);
+}
+
+void Packer::addBin(Bin&& bin) {
+    bins.push_back(std::move(bin));
+    bins.back().attach(&items);
+}
+
+const std::vector<std::shared_ptr<const ItemType>>& Packer::getItemTypes() const {
+    return item_types;
+}
+
+uint32_t Packer::internType(Item& item) {
+    auto it = type_index.find(&item.getType());
+    if (it != type_index.end()) {
+        item.setType(item_types[it->second]);
+        return it->second;
+    }
+    const auto id = static_cast<uint32_t>(item_types.size());
+    item_types.push_back(item.getSharedType());
+    type_index.emplace(item_types.back().get(), id);
+    return id;
 }
 
 void Packer::addItem(const Item& item) {
-    items.push_back(item);
+    const ItemHandle handle = items.add(item);
+    items[handle].input_index = handle;
+    internType(items[handle]);
+}
+
+void Packer::addItem(Item&& item) {
+    const ItemHandle handle = items.add(std::move(item));
+    items[handle].input_index = handle;
+    internType(items[handle]);
+}
+
+uint32_t Packer::addItemType(const Dimension& dims, const std::vector<RotationType>& rotations,
+                             uint8_t flags, float weight, size_t quantity,
+                             const std::string& name, const std::string& color) {
+    Item unit(name, dims[0], dims[1], dims[2], rotations, color, weight, 0, 0.0f, 0,
+              (flags & ITEM_BOTTOM_LOAD_ONLY) != 0, (flags & ITEM_DISABLE_STACKING) != 0);
+    const uint32_t id = internType(unit);
+    items.reserve(items.size() + quantity);
+    for (size_t i = 0; i < quantity; ++i) {
+        // Units only copy the shared type pointer
+        const ItemHandle handle = items.add(unit);
+        items[handle].input_index = handle;
+    }
+    return id;
+}
+
+void Packer::addItems(size_t count, const int64_t* dims, const float* weights,
+                      const uint8_t* flags, const uint8_t* rotation_masks) {
+    items.reserve(items.size() + count);
+    std::vector<RotationType> rotations;
+    for (size_t i = 0; i < count; ++i) {
+        rotations.clear();
+        const unsigned mask = rotation_masks ? rotation_masks[i] : 0;
+        for (unsigned r = 0; r < 6; ++r) {
+            if (mask & (1u << r)) {
+                rotations.push_back(static_cast<RotationType>(r));
+            }
+        }
+        const uint8_t f = flags ? flags[i] : 0;
+        addItem(Item("", dims[3 * i], dims[3 * i + 1], dims[3 * i + 2], rotations, "#000000",
+                     weights ? weights[i] : 0.0f, 0, 0.0f, 0,
+                     (f & ITEM_BOTTOM_LOAD_ONLY) != 0, (f & ITEM_DISABLE_STACKING) != 0));
+    }
+}
+
+void Packer::writePlacements(int32_t* bin_index, int64_t* position, uint8_t* rotation, int64_t* packed_dims) const {
+    const size_t count = items.size();
+    std::fill(bin_index, bin_index + count, -1);
+    std::fill(position, position + 3 * count, 0);
+    std::fill(rotation, rotation + count, 0);
+    std::fill(packed_dims, packed_dims + 3 * count, 0);
+    // Only packed items are written: an unpacked one may still hold the
+    // position of its last failed attempt, and its row stays all zeros
+    for (size_t b = 0; b < bins.size(); ++b) {
+        for (auto handle : bins[b].getItemHandles()) {
+            const Item& item = items[handle];
+            const size_t row = item.input_index;
+            if (row >= count) continue;
+            const auto& [x, y, z] = item.getPosition();
+            const auto d = item.getDims();
+            bin_index[row] = static_cast<int32_t>(b);
+            position[3 * row] = x;
+            position[3 * row + 1] = y;
+            position[3 * row + 2] = z;
+            rotation[row] = static_cast<uint8_t>(item.getRotationType());
+            packed_dims[3 * row] = d[0];
+            packed_dims[3 * row + 1] = d[1];
+            packed_dims[3 * row + 2] = d[2];
+        }
+    }
 }
 
 std::optional<std::reference_wrapper<Bin>> Packer::findFittedBin(Item& item) {
     for (auto& bin : bins) {
+        countStat(&PackStats::bins_tried);
         if (!bin.putItem(item, START_POSITION)) {
             continue;
         }
-        if (bin.getItems().size() == 1 && &bin.getItems()[0].get() == &item) {
+        if (bin.itemCount() == 1 && bin.getItemHandles()[0] == item.input_index) {
             bin.setItems({});
         }
         return std::ref(bin);
@@ -52,9 +298,124 @@ std::optional<std::reference_wrapper<Bin>> Packer::getBiggerBinThan(const Bin& o
     return std::nullopt;
 }
 
+std::vector<Bin*> Packer::binsAccepting(Item& item) {
+    std::vector<Bin*> candidates;
+    for (auto& bin : bins) {
+        countStat(&PackStats::bins_tried);
+        if (!bin.putItem(item, START_POSITION)) {
+            continue;
+        }
+        if (bin.itemCount() == 1 && bin.getItemHandles()[0] == item.input_index) {
+            bin.setItems({});
+        }
+        candidates.push_back(&bin);
+    }
+    return candidates;
+}
+
+std::vector<Bin*> Packer::binsBiggerThan(const Bin& other_bin) {
+    std::vector<Bin*> candidates;
+    for (auto& bin : bins) {
+        if (bin.getVolume() > other_bin.getVolume()) {
+            candidates.push_back(&bin);
+        }
+    }
+    return candidates;
+}
+
+Packer::BinTrial Packer::trialPack(Bin& bin, std::vector<Item>& scratch_items) const {
+    // Runs on a worker: only touches the scratch bin and items it was handed
+    BinTrial trial;
+    PackStatsScope scope(&trial.stats);
+    Packer scratch;
+    scratch.options = options;
+    // The scratch has no bins of its own to trial
+    scratch.options.bin_selection = BinSelection::first_fit;
+    std::vector<Item*> ptrs;
+    ptrs.reserve(scratch_items.size());
+    for (auto& item : scratch_items) {
+        ptrs.push_back(&item);
+    }
+    auto unpacked = scratch.packToBin(bin, ptrs);
+
+    trial.leftovers = unpacked.size();
+    for (auto& item : scratch_items) {
+        trial.packed_volume += item.getVolume();
+    }
+    for (auto* item : unpacked) {
+        trial.packed_volume -= item->getVolume();
+    }
+    return trial;
+}
+
+std::optional<std::reference_wrapper<Bin>> Packer::selectBin(const std::vector<Bin*>& candidates,
+                                                             const std::vector<Item*>& item_ptrs) {
+    if (candidates.empty()) {
+        return std::nullopt;
+    }
+    if (candidates.size() == 1) {
+        return std::ref(*candidates.front());
+    }
+
+    // Copy everything on this thread first; the trials then share nothing
+    std::vector<Bin> scratch_bins;
+    std::vector<std::vector<Item>> scratch_items(candidates.size());
+    scratch_bins.reserve(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        scratch_bins.push_back(*candidates[i]);
+        scratch_items[i].reserve(item_ptrs.size());
+        for (auto* item : item_ptrs) {
+            scratch_items[i].push_back(*item);
+        }
+    }
+
+    // Without a pool (threads == 1) the trials run inline, one after another
+    std::vector<std::future<BinTrial>> trials;
+    std::vector<BinTrial> results;
+    results.reserve(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (pool) {
+            trials.push_back(pool->submit([this, &scratch_bins, &scratch_items, i]() {
+                return trialPack(scratch_bins[i], scratch_items[i]);
+            }));
+        } else {
+            results.push_back(trialPack(scratch_bins[i], scratch_items[i]));
+        }
+    }
+    for (auto& trial : trials) {
+        results.push_back(trial.get());
+    }
+
+    for (const auto& trial : results) {
+        countStat(&PackStats::bin_trials);
+        if (PackStats* stats = currentPackStats()) {
+            stats->merge(trial.stats);
+        }
+    }
+
+    // Ties go to the earlier (smaller) bin so results do not depend on timing
+    size_t best = 0;
+    const BinTrial* best_trial = &results[0];
+    double best_fill = static_cast<double>(best_trial->packed_volume) / candidates[0]->getVolume();
+    for (size_t i = 1; i < results.size(); ++i) {
+        const BinTrial& trial = results[i];
+        double fill = static_cast<double>(trial.packed_volume) / candidates[i]->getVolume();
+        bool better = options.bin_selection == BinSelection::best_fill
+            ? (fill > best_fill || (fill == best_fill && trial.leftovers < best_trial->leftovers))
+            : (trial.leftovers < best_trial->leftovers ||
+               (trial.leftovers == best_trial->leftovers && fill > best_fill));
+        if (better) {
+            best = i;
+            best_trial = &trial;
+            best_fill = fill;
+        }
+    }
+    return std::ref(*candidates[best]);
+}
+
 void Packer::unfitItem(std::vector<Item*>& item_ptrs) {
     if (!item_ptrs.empty()) {
-        unfit_items.push_back(*item_ptrs.front());
+        unfit_items.push_back(item_ptrs.front()->input_index);
         item_ptrs.erase(item_ptrs.begin());
     }
 }
@@ -63,135 +424,684 @@ std::vector<Item*> Packer::packToBin(Bin& bin, std::vector<Item*>& item_ptrs) {
     std::vector<Item*> unpacked;
     std::optional<std::reference_wrapper<Bin>> b2;
     
-    // Fast sort with simpler criteria
-    std::sort(item_ptrs.begin(), item_ptrs.end(), [](const Item* a, const Item* b) {
-        return a->getVolume() > b->getVolume();
-    });
+    // Random orderings are fixed once in pack() and search sequences by the
+    // improvement phase; re-sorting would undo them. Lists from packGreedy
+    // are already in order, so this is one linear check.
+    auto before = [this](const Item* a, const Item* b) { return orderedBefore(*a, *b); };
+    if (!fixed_sequence && options.ordering != ItemOrdering::random &&
+        !std::is_sorted(item_ptrs.begin(), item_ptrs.end(), before)) {
+        std::sort(item_ptrs.begin(), item_ptrs.end(), before);
+    }
 
+    countStat(&PackStats::candidates_start);
     if (!bin.putItem(*item_ptrs[0], START_POSITION)) {
-        b2 = getBiggerBinThan(bin);
+        b2 = options.bin_selection == BinSelection::first_fit
+            ? getBiggerBinThan(bin)
+            : selectBin(binsBiggerThan(bin), item_ptrs);
         if (b2) {
             return packToBin(b2->get(), item_ptrs);
         }
         return {item_ptrs.begin(), item_ptrs.end()};
     }
     
-    // Cache bin dimensions
-    const long binWidth = bin.getWidth();
-    const long binHeight = bin.getHeight();
-    const long binDepth = bin.getDepth();
+    // A unit fails exactly where the last unit of its type failed unless the
+    // bin has changed since, so remember the item count at each type's failure
+    std::unordered_map<const ItemType*, size_t> failed_at;
+
+    // Units of a type sit next to each other; run_end[i] is where i's run stops
+    std::vector<size_t> run_end(item_ptrs.size());
+    for (size_t i = item_ptrs.size(); i-- > 0;) {
+        const bool same = i + 1 < item_ptrs.size() && &item_ptrs[i + 1]->getType() == &item_ptrs[i]->getType();
+        run_end[i] = same ? run_end[i + 1] : i + 1;
+    }
 
     for (size_t i = 1; i < item_ptrs.size(); ++i) {
+        if (outOfTime()) {
+            unpacked.insert(unpacked.end(), item_ptrs.begin() + i, item_ptrs.end());
+            break;
+        }
         bool fitted = false;
         Item* current_item = item_ptrs[i];
-        
-        // CRITICAL FIX: Use a single approach for all item types with special case handling
-        // This drastically reduces the time complexity
-        
-        // Calculate step size based on bin dimensions - much larger steps
-        const long step_x = std::max(10L, binWidth / 5);
-        const long step_y = std::max(10L, binHeight / 5);
-        const long step_z = std::max(10L, binDepth / 5);
-        
-        // Try adjacent to existing items first (most efficient)
-        for (const auto& item_b : bin.getItems()) {
-            if (fitted) break;
-            
-            const auto& pos_b = item_b.get().getPosition();
-            const auto& dim_b = item_b.get().getDimension();
-            
-            // Only generate a few high-value positions
-            std::vector<std::tuple<long, long, long>> positions;
-            
-            // Bottom load only at ground level
-            if (current_item->bottom_load_only) {
-                positions = {
-                    {std::get<0>(pos_b) + dim_b[0], 0, std::get<2>(pos_b)},
-                    {std::get<0>(pos_b), 0, std::get<2>(pos_b) + dim_b[2]}
-                };
-            }
-            // For regular and disable_stacking items
-            else {
-                positions = {
-                    {std::get<0>(pos_b) + dim_b[0], std::get<1>(pos_b), std::get<2>(pos_b)}, // Right
-                    {std::get<0>(pos_b), std::get<1>(pos_b) + dim_b[1], std::get<2>(pos_b)}, // Above
-                    {std::get<0>(pos_b), std::get<1>(pos_b), std::get<2>(pos_b) + dim_b[2]}  // Behind
-                };
-                
-                // Don't try above position for disable_stacking
-                if (item_b.get().disable_stacking || current_item->disable_stacking) {
-                    positions.erase(positions.begin() + 1);
-                }
-            }
-            
-            // Try each position
-            for (const auto& pos : positions) {
-                if (bin.putItem(*current_item, pos)) {
+        auto failed = failed_at.find(&current_item->getType());
+        if (failed != failed_at.end() && failed->second == bin.itemCount()) {
+            unpacked.push_back(current_item);
+            continue;
+        }
+
+        // Try the bin's extreme points in order; they already sit against walls
+        // or placed items, so no blind grid probing is needed
+        const auto& points = bin.getExtremePoints();
+        for (size_t k = 0; k < points.size() && !outOfTime(); ++k) {
+            const auto pos = points[k];
+            if (current_item->bottomLoadOnly() && std::get<1>(pos) != 0) continue;
+            countStat(&PackStats::candidates_extreme_point);
+            const size_t run = run_end[i] - i;
+            if (options.block_building && run > 1) {
+                // Block stage: the whole run, or as much of it as fits here,
+                // goes in with one collision query
+                const BlockShape shape = bin.findBlock(*current_item, pos, run);
+                if (shape.size() == 0) continue;
+                if (shape.size() > 1) {
+                    bin.placeBlock(&item_ptrs[i], pos, shape);
+                    countStat(&PackStats::blocks_placed);
+                    countStat(&PackStats::block_units, shape.size());
+                    i += shape.size() - 1;
                     fitted = true;
                     break;
                 }
             }
-        }
-        
-        // CRITICAL FIX: If not fitted, use very sparse grid search
-        if (!fitted) {
-            // Use much larger increment for grid search
-            if (current_item->bottom_load_only) {
-                // Bottom load items only need 2D search at y=0
-                for (long x = 0; x <= binWidth && !fitted; x += step_x) {
-                    for (long z = 0; z <= binDepth && !fitted; z += step_z) { // FIX: z <= binDepth 
-                        if (bin.putItem(*current_item, {x, 0, z})) {
-                            fitted = true;
-                            break;
-                        }
-                    }
-                }
-            } 
-            else {
-                // Regular items - just do a very sparse 3D grid
-                for (long y = 0; y <= binHeight && !fitted; y += step_y) {
-                    // Skip higher y values for disable_stacking
-                    if (current_item->disable_stacking && y > step_y) continue;
-                    
-                    for (long x = 0; x <= binWidth && !fitted; x += step_x) {
-                        for (long z = 0; z <= binDepth && !fitted; z += step_z) { // FIX: z <= binDepth
-                            if (bin.putItem(*current_item, {x, y, z})) {
-                                fitted = true;
-                                break;
-                            }
-                        }
-                    }
-                }
+            if (bin.putItem(*current_item, pos)) {
+                fitted = true;
+                break;
             }
         }
         
+        if (!fitted && stopped) {
+            // Cut short: this and every later item stay unpacked
+            unpacked.insert(unpacked.end(), item_ptrs.begin() + i, item_ptrs.end());
+            break;
+        }
         if (!fitted) {
+            log_debug("packer", "item_deferred", LogField("bin", bin.id), LogField("item", current_item->input_index),
+                      LogField("points", points.size()));
+            failed_at[&current_item->getType()] = bin.itemCount();
             unpacked.push_back(current_item);
         }
     }
     return unpacked;
 }
 
+Placement Packer::place(const Item& item, bool open_bin) {
+    PackStatsScope scope(&pack_stats);
+    addItem(item);
+    Placement placement;
+    placement.item = static_cast<ItemHandle>(items.size() - 1);
+    Item& unit = items[placement.item];
+
+    auto placedIn = [&](size_t b, bool opened) {
+        placement.bin = static_cast<int32_t>(b);
+        placement.position = unit.getPosition();
+        placement.rotation = unit.getRotationType();
+        placement.opened_bin = opened;
+        return placement;
+    };
+
+    for (size_t b = 0; b < bins.size(); ++b) {
+        Bin& bin = bins[b];
+        if (bin.itemCount() == 0) continue;
+        // A full bin is passed over without walking its extreme points
+        if (bin.getLoadVolume() + unit.getVolume() > static_cast<double>(bin.getVolume()) ||
+            (bin.max_weight > 0 && bin.getLoadWeight() + unit.getWeight() > bin.max_weight)) {
+            continue;
+        }
+        if (bin.putItemFirstFit(unit)) {
+            return placedIn(b, false);
+        }
+    }
+    if (open_bin) {
+        for (size_t b = 0; b < bins.size(); ++b) {
+            if (bins[b].itemCount() != 0) continue;
+            countStat(&PackStats::candidates_start);
+            if (bins[b].putItem(unit, START_POSITION)) {
+                return placedIn(b, true);
+            }
+        }
+    }
+    log_debug("packer", "item_unplaced", LogField("item", placement.item), LogField("volume", unit.getVolume()));
+    unfit_items.push_back(placement.item);
+    return placement;
+}
+
 void Packer::pack() {
+    pack(PackOptions{});
+}
+
+bool Packer::orderedBefore(const Item& a, const Item& b) const {
+    auto longest = [](const Item& item) {
+        return std::max({item.getWidth(), item.getHeight(), item.getDepth()});
+    };
+    switch (options.ordering) {
+        case ItemOrdering::longest_edge:
+            if (longest(a) != longest(b)) return longest(a) > longest(b);
+            break;
+        case ItemOrdering::base_area:
+            if (a.getWidth() * a.getDepth() != b.getWidth() * b.getDepth()) {
+                return a.getWidth() * a.getDepth() > b.getWidth() * b.getDepth();
+            }
+            break;
+        case ItemOrdering::weight:
+            if (a.getWeight() != b.getWeight()) return a.getWeight() > b.getWeight();
+            break;
+        case ItemOrdering::volume:
+        case ItemOrdering::random:
+            break;
+    }
+    return a.getVolume() > b.getVolume();
+}
+
+void Packer::orderItems(std::vector<Item*>& item_ptrs) const {
+    // Rank the distinct types once, then lay out the units type by type in
+    // input order, so the cost is a sort of SKUs plus one pass over units
+    std::unordered_map<const ItemType*, size_t> rank;
+    std::vector<const Item*> representatives;
+    for (const Item* item : item_ptrs) {
+        if (rank.emplace(&item->getType(), representatives.size()).second) {
+            representatives.push_back(item);
+        }
+    }
+    std::vector<size_t> type_order(representatives.size());
+    for (size_t i = 0; i < type_order.size(); ++i) {
+        type_order[i] = i;
+    }
+    std::sort(type_order.begin(), type_order.end(), [&](size_t a, size_t b) {
+        return orderedBefore(*representatives[a], *representatives[b]);
+    });
+    std::vector<size_t> offset(type_order.size() + 1, 0);
+    for (size_t position = 0; position < type_order.size(); ++position) {
+        rank[&representatives[type_order[position]]->getType()] = position;
+    }
+    for (const Item* item : item_ptrs) {
+        ++offset[rank[&item->getType()] + 1];
+    }
+    for (size_t i = 1; i < offset.size(); ++i) {
+        offset[i] += offset[i - 1];
+    }
+    std::vector<Item*> ordered(item_ptrs.size());
+    for (Item* item : item_ptrs) {
+        ordered[offset[rank[&item->getType()]]++] = item;
+    }
+    item_ptrs.swap(ordered);
+
+    if (options.ordering == ItemOrdering::random) {
+        // Perturb the volume order: each item may swap with one of the next few
+        constexpr size_t WINDOW = 4;
+        std::mt19937_64 rng(options.seed);
+        for (size_t i = 0; i + 1 < item_ptrs.size(); ++i) {
+            const size_t reach = std::min(WINDOW, item_ptrs.size() - i);
+            std::swap(item_ptrs[i], item_ptrs[i + rng() % reach]);
+        }
+    }
+}
+
+bool Packer::betterThan(const Packer& other, PackObjective objective) const {
+    struct Summary {
+        long packed_volume = 0;
+        long used_volume = 0;
+        size_t used_bins = 0;
+        size_t unfit = 0;
+    };
+    auto summarize = [](const Packer& packer) {
+        Summary summary;
+        summary.unfit = packer.unfit_items.size();
+        for (const auto& bin : packer.bins) {
+            if (bin.itemCount() == 0) continue;
+            ++summary.used_bins;
+            summary.used_volume += bin.getVolume();
+            for (auto handle : bin.getItemHandles()) {
+                summary.packed_volume += packer.items[handle].getVolume();
+            }
+        }
+        return summary;
+    };
+    const Summary a = summarize(*this);
+    const Summary b = summarize(other);
+
+    switch (objective) {
+        case PackObjective::fewest_bins:
+            if (a.unfit != b.unfit) return a.unfit < b.unfit;
+            if (a.used_bins != b.used_bins) return a.used_bins < b.used_bins;
+            return a.packed_volume > b.packed_volume;
+        case PackObjective::fill_ratio: {
+            // Compare a.packed / a.used against b.packed / b.used without dividing
+            const double fill_a = static_cast<double>(a.packed_volume) * std::max(1L, b.used_volume);
+            const double fill_b = static_cast<double>(b.packed_volume) * std::max(1L, a.used_volume);
+            if (fill_a != fill_b) return fill_a > fill_b;
+            return a.packed_volume > b.packed_volume;
+        }
+        case PackObjective::packed_volume:
+        default:
+            if (a.packed_volume != b.packed_volume) return a.packed_volume > b.packed_volume;
+            return a.used_bins < b.used_bins;
+    }
+}
+
+void Packer::packPortfolio(const PackOptions& pack_options) {
+    std::vector<PackOptions> runs;
+    PackOptions run = pack_options;
+    run.portfolio.clear();
+    run.random_starts = 0;
+    // Only the winner is improved, after the runs
+    run.improve_seconds = 0;
+    run.improve_iterations = 0;
+    // Runs already fill the pool below, so their trial packs stay on the worker
+    run.threads = 1;
+    for (auto ordering : pack_options.portfolio) {
+        run.ordering = ordering;
+        runs.push_back(run);
+    }
+    for (size_t k = 0; k < pack_options.random_starts; ++k) {
+        run.ordering = ItemOrdering::random;
+        run.seed = pack_options.seed + k;
+        runs.push_back(run);
+    }
+
+    // Clone on this thread; each worker then owns its problem outright
+    std::vector<Packer> results;
+    results.reserve(runs.size());
+    for (size_t i = 0; i < runs.size(); ++i) {
+        results.push_back(cloneProblem());
+    }
+    // Once a run reaches the lower bound nothing can beat it, so later runs
+    // not yet started are skipped. Earlier runs still go, which keeps the
+    // winner the same as with every run done.
+    std::atomic<size_t> first_solved{runs.size()};
+    std::vector<uint8_t> ran(runs.size(), 0);
+    {
+        ThreadPool workers(std::min(pack_options.threads ? pack_options.threads
+                                                         : std::max(1u, std::thread::hardware_concurrency()),
+                                    runs.size()));
+        std::vector<std::future<void>> done;
+        for (size_t i = 0; i < runs.size(); ++i) {
+            done.push_back(workers.submit([&results, &runs, &first_solved, &ran, i]() {
+                if (first_solved.load() < i) return;
+                results[i].pack(runs[i]);
+                ran[i] = 1;
+                if (results[i].reachesBound()) {
+                    size_t solved = first_solved.load();
+                    while (i < solved && !first_solved.compare_exchange_weak(solved, i)) {}
+                }
+            }));
+        }
+        for (auto& f : done) {
+            f.get();
+        }
+    }
+
+    if (PackStats* stats = currentPackStats()) {
+        for (const auto& result : results) {
+            stats->merge(result.stats());
+        }
+    }
+    // Runs share the deadline and token; if any was cut short, so was the portfolio
+    for (const auto& result : results) {
+        stopped = stopped || result.truncated();
+    }
+
+    // Earliest run wins ties so the choice does not depend on timing
+    size_t best = 0;
+    for (size_t i = 1; i < results.size(); ++i) {
+        if (ran[i] && results[i].betterThan(results[best], pack_options.objective)) {
+            best = i;
+        }
+    }
+    // Move assignment re-attaches the winning bins to this packer's arena
+    *this = std::move(results[best]);
+    options = pack_options;
+}
+
+PackOptions startClock(const PackOptions& options, Clock::time_point start) {
+    PackOptions started = options;
+    if (options.time_limit > 0) {
+        started.deadline = std::min(options.deadline,
+                                    start + std::chrono::duration_cast<Clock::duration>(
+                                                std::chrono::duration<double>(options.time_limit)));
+        started.time_limit = 0;
+    }
+    return started;
+}
+
+void Packer::pack(const PackOptions& requested) {
+    // Collected in a local: the portfolio path replaces *this wholesale
+    const auto start = Clock::now();
+    const PackOptions pack_options = startClock(requested, start);
+    PackStats stats;
+    stopped = false;
+    stop_checks = 0;
+    pack_bounds.reset();
+    {
+        PackStatsScope scope(&stats);
+        if (!pack_options.portfolio.empty() || pack_options.random_starts > 0) {
+            packPortfolio(pack_options);
+        } else {
+            options = pack_options;
+            std::unique_ptr<ThreadPool> trial_pool;
+            if (options.bin_selection != BinSelection::first_fit && options.threads != 1) {
+                trial_pool = std::make_unique<ThreadPool>(options.threads);
+                pool = trial_pool.get();
+            }
+            packGreedy();
+            pool = nullptr;
+        }
+        pack_truncated = stopped;
+        if (!pack_truncated && (options.improve_seconds > 0 || options.improve_iterations > 0)) {
+            improve();
+        }
+    }
+    stats.seconds_total = secondsSince(start);
+    pack_stats = stats;
+    log_info("packer", "pack_done", LogField("items", items.size()), LogField("unfit", unfit_items.size()),
+             LogField("attempts", stats.put_attempts), LogField("seconds", stats.seconds_total),
+             LogField("truncated", pack_truncated));
+}
+
+void Packer::packGreedy() {
+    countStat(&PackStats::packs_run);
+    PackStats* stats = currentPackStats();
+
+    auto phase = Clock::now();
     std::sort(bins.begin(), bins.end(), [](const Bin& a, const Bin& b) {
         return a.getVolume() < b.getVolume();
     });
-    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
-        return a.getVolume() > b.getVolume();
-    });
 
+    // Items stay where they are in the arena; only the pointers are ordered.
+    // Units that fit no bin in any rotation go straight to unfit_items.
     std::vector<Item*> item_ptrs;
+    item_ptrs.reserve(items.size());
+    std::unordered_map<const ItemType*, bool> fits_a_bin;
     for (auto& itm : items) {
-        item_ptrs.push_back(&itm);
+        auto [fits, added] = fits_a_bin.try_emplace(&itm.getType(), false);
+        if (added) {
+            fits->second = fitsAnyBin(itm, bins);
+        }
+        if (fits->second) {
+            item_ptrs.push_back(&itm);
+        } else {
+            unfit_items.push_back(itm.input_index);
+            countStat(&PackStats::prefiltered_unfit);
+        }
+    }
+    orderItems(item_ptrs);
+
+    // Score rotations once per item type and bin up front
+    for (const auto& bin : bins) {
+        for (const auto& type : item_types) {
+            bin.getRotationPlan(Item(type));
+        }
     }
+    if (stats) stats->seconds_ordering += secondsSince(phase);
+    packSequence(std::move(item_ptrs));
+}
 
+void Packer::packSequence(std::vector<Item*> item_ptrs) {
+    PackStats* stats = currentPackStats();
+    auto phase = Clock::now();
+
+    // Units of a type that fit no bin are followed by more of the same
+    const ItemType* unfit_type = nullptr;
     while (!item_ptrs.empty()) {
-        auto bin = findFittedBin(*item_ptrs[0]);
+        if (outOfTime()) {
+            for (auto* item : item_ptrs) {
+                unfit_items.push_back(item->input_index);
+            }
+            break;
+        }
+        if (&item_ptrs[0]->getType() == unfit_type) {
+            unfitItem(item_ptrs);
+            continue;
+        }
+        phase = Clock::now();
+        auto bin = options.bin_selection == BinSelection::first_fit
+            ? findFittedBin(*item_ptrs[0])
+            : selectBin(binsAccepting(*item_ptrs[0]), item_ptrs);
+        if (stats) stats->seconds_bin_selection += secondsSince(phase);
         if (!bin) {
+            log_debug("packer", "item_unfit", LogField("item", item_ptrs[0]->input_index));
+            unfit_type = &item_ptrs[0]->getType();
             unfitItem(item_ptrs);
             continue;
         }
+        phase = Clock::now();
         auto unpacked_items = packToBin(bin->get(), item_ptrs);
+        if (stats) stats->seconds_packing += secondsSince(phase);
+        unfit_type = nullptr;
         item_ptrs = unpacked_items;
     }
 }
+
+double Packer::searchCost(PackObjective objective) const {
+    double total_volume = 0;
+    for (const auto& item : items) {
+        total_volume += item.getVolume();
+    }
+    double packed_volume = 0;
+    double used_volume = 0;
+    double least_fill = 1;
+    size_t used_bins = 0;
+    for (const auto& bin : bins) {
+        if (bin.itemCount() == 0) continue;
+        double bin_volume = 0;
+        for (auto handle : bin.getItemHandles()) {
+            bin_volume += items[handle].getVolume();
+        }
+        ++used_bins;
+        packed_volume += bin_volume;
+        used_volume += bin.getVolume();
+        least_fill = std::min(least_fill, bin_volume / bin.getVolume());
+    }
+
+    switch (objective) {
+        case PackObjective::fewest_bins:
+            // Same order as betterThan; the emptiest bin's fill leads the
+            // search towards solutions where that bin can be closed
+            return static_cast<double>(unfit_items.size()) * (bins.size() + 1) + used_bins + least_fill;
+        case PackObjective::fill_ratio:
+            return used_volume > 0 ? 1 - packed_volume / used_volume : 1;
+        case PackObjective::packed_volume:
+        default:
+            return (total_volume > 0 ? 1 - packed_volume / total_volume : 0) + 1e-6 * (used_bins + least_fill);
+    }
+}
+
+void Packer::improve() {
+    const auto start = Clock::now();
+    const PackObjective objective = options.objective;
+
+    // Moves are replayed on a working copy; *this always holds the best packing
+    Packer trial = *this;
+    trial.fixed_sequence = true;
+    std::unique_ptr<ThreadPool> trial_pool;
+    if (options.bin_selection != BinSelection::first_fit && options.threads != 1) {
+        trial_pool = std::make_unique<ThreadPool>(options.threads);
+        trial.pool = trial_pool.get();
+    }
+
+    // Start from the packing at hand: bin by bin in placement order, then the unfit items
+    std::vector<Item*> sequence;
+    sequence.reserve(trial.items.size());
+    for (const auto& bin : trial.bins) {
+        for (auto handle : bin.getItemHandles()) {
+            sequence.push_back(&trial.items[handle]);
+        }
+    }
+    for (auto handle : trial.unfit_items) {
+        sequence.push_back(&trial.items[handle]);
+    }
+    if (sequence.size() != trial.items.size() || trial.bins.empty()) {
+        return;
+    }
+
+    auto decode = [&]() {
+        for (auto& bin : trial.bins) {
+            bin.setItems({});
+        }
+        trial.unfit_items.clear();
+        trial.packSequence(sequence);
+        return trial.searchCost(objective);
+    };
+    // A decode cut short by the deadline or cancel token has dumped the rest
+    // of the sequence unfit, so it is neither kept nor accepted
+    auto keepIfBest = [&]() {
+        if (!trial.stopped && trial.betterThan(*this, objective)) {
+            *this = trial;
+            countStat(&PackStats::improve_best);
+        }
+    };
+    double current = decode();
+    keepIfBest();
+
+    // Items worth moving forward: the unfit ones and those in the emptiest bin
+    std::vector<size_t> tail;
+    auto collectTail = [&]() {
+        std::vector<uint8_t> in_tail(trial.items.size(), 0);
+        for (auto handle : trial.unfit_items) {
+            in_tail[handle] = 1;
+        }
+        const Bin* emptiest = nullptr;
+        double emptiest_fill = 2;
+        for (const auto& bin : trial.bins) {
+            if (bin.itemCount() == 0) continue;
+            double fill = 0;
+            for (auto handle : bin.getItemHandles()) {
+                fill += trial.items[handle].getVolume();
+            }
+            fill /= bin.getVolume();
+            if (fill < emptiest_fill) {
+                emptiest_fill = fill;
+                emptiest = &bin;
+            }
+        }
+        if (emptiest) {
+            for (auto handle : emptiest->getItemHandles()) {
+                in_tail[handle] = 1;
+            }
+        }
+        tail.clear();
+        for (size_t i = 0; i < sequence.size(); ++i) {
+            if (in_tail[sequence[i]->input_index]) {
+                tail.push_back(i);
+            }
+        }
+    };
+    collectTail();
+
+    constexpr size_t HISTORY_LENGTH = 50;
+    constexpr double START_TEMPERATURE = 0.02;
+    constexpr double END_TEMPERATURE = 0.0002;
+    constexpr size_t PICK_TRIES = 8;
+    std::vector<double> history(HISTORY_LENGTH, current);
+    std::mt19937_64 rng(options.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<Item*> saved;
+
+    auto sameShape = [](const Bin& a, const Bin& b) {
+        return a.getWidth() == b.getWidth() && a.getHeight() == b.getHeight() && a.getDepth() == b.getDepth();
+    };
+
+    size_t iteration = 0;
+    for (;; ++iteration) {
+        const double elapsed = secondsSince(start);
+        if ((options.improve_iterations > 0 && iteration >= options.improve_iterations) ||
+            (options.improve_seconds > 0 && elapsed >= options.improve_seconds) ||
+            options.cancel_token.cancelled() || Clock::now() >= options.deadline || trial.stopped) {
+            break;
+        }
+        if (reachesBound()) {
+            log_info("packer", "bound_reached", LogField("iterations", iteration), LogField("bins", packBounds().lower()));
+            break;
+        }
+        saved = sequence;
+        size_t bin_a = 0, bin_b = 0;
+        bool bins_swapped = false;
+        const auto kind = rng() % 10;
+        if (kind >= 8 && trial.bins.size() > 1) {
+            // Open a different bin type earlier
+            for (size_t t = 0; t < PICK_TRIES && !bins_swapped; ++t) {
+                bin_a = rng() % trial.bins.size();
+                bin_b = rng() % trial.bins.size();
+                bins_swapped = !sameShape(trial.bins[bin_a], trial.bins[bin_b]);
+            }
+            if (bins_swapped) {
+                std::swap(trial.bins[bin_a], trial.bins[bin_b]);
+            }
+        } else if (kind < 4 && sequence.size() > 1) {
+            // Remove and reinsert earlier, mostly items that ended up unfit or in the emptiest bin
+            const size_t from = !tail.empty() && rng() % 10 < 7 ? tail[rng() % tail.size()]
+                                                                : 1 + rng() % (sequence.size() - 1);
+            if (from > 0) {
+                const size_t to = rng() % from;
+                Item* moved = sequence[from];
+                sequence.erase(sequence.begin() + from);
+                sequence.insert(sequence.begin() + to, moved);
+            }
+        } else if (sequence.size() > 1) {
+            // Swap two units of different types
+            for (size_t t = 0; t < PICK_TRIES; ++t) {
+                const size_t i = rng() % sequence.size();
+                const size_t j = rng() % sequence.size();
+                if (&sequence[i]->getType() != &sequence[j]->getType()) {
+                    std::swap(sequence[i], sequence[j]);
+                    break;
+                }
+            }
+        }
+        if (!bins_swapped && sequence == saved) {
+            continue;
+        }
+
+        countStat(&PackStats::improve_moves);
+        const double cost = decode();
+        if (trial.stopped) {
+            break;
+        }
+        keepIfBest();
+
+        bool accept = cost <= current;
+        if (!accept && options.acceptance == SearchAcceptance::late_acceptance) {
+            accept = cost <= history[iteration % HISTORY_LENGTH];
+        } else if (!accept) {
+            double progress = 0;
+            if (options.improve_iterations > 0) {
+                progress = static_cast<double>(iteration) / options.improve_iterations;
+            }
+            if (options.improve_seconds > 0) {
+                progress = std::max(progress, elapsed / options.improve_seconds);
+            }
+            const double temperature = START_TEMPERATURE * std::pow(END_TEMPERATURE / START_TEMPERATURE, progress);
+            accept = unit(rng) < std::exp((current - cost) / temperature);
+        }
+        if (accept) {
+            current = cost;
+            countStat(&PackStats::improve_accepted);
+            collectTail();
+        } else {
+            sequence.swap(saved);
+            if (bins_swapped) {
+                std::swap(trial.bins[bin_a], trial.bins[bin_b]);
+            }
+        }
+        history[iteration % HISTORY_LENGTH] = current;
+    }
+
+    if (PackStats* stats = currentPackStats()) {
+        stats->seconds_improving += secondsSince(start);
+    }
+    log_info("packer", "improve_done", LogField("iterations", iteration), LogField("cost", current),
+             LogField("unfit", unfit_items.size()), LogField("seconds", secondsSince(start)));
+}
+
+void packMany(const std::vector<Packer*>& packers, const PackOptions& options, size_t threads) {
+    std::unordered_set<const Packer*> seen;
+    for (const auto* packer : packers) {
+        if (!packer || !seen.insert(packer).second) {
+            throw std::invalid_argument("packMany: every packer must be distinct and non-null");
+        }
+    }
+    if (packers.empty()) {
+        return;
+    }
+
+    // Each pack already has a worker to itself; nested trial pools would only oversubscribe
+    PackOptions run = options;
+    run.threads = 1;
+    ThreadPool workers(std::min(threads ? threads : std::max(1u, std::thread::hardware_concurrency()),
+                                packers.size()));
+    std::vector<std::future<void>> done;
+    done.reserve(packers.size());
+    for (auto* packer : packers) {
+        done.push_back(workers.submit([packer, &run]() { packer->pack(run); }));
+    }
+    // If one pack throws, the pool still finishes the rest before unwinding
+    for (auto& f : done) {
+        f.get();
+    }
+}
@@ -1,5 +1,6 @@
 #include "pallet.h"
 #include <algorithm>
+#include <tuple>
 
 Pallet::Pallet(double length, double width, double thickness, double max_height, double max_weight)
     : length_(length)
@@ -20,11 +21,16 @@ double Pallet::getCurrentHeight() const { return current_height_; }
 double Pallet::getCurrentWeight() const { return current_weight_; }
 const std::vector<Item*>& Pallet::getItems() const { return items_; }
 
+double Pallet::topOf(const Item& item) {
+    return static_cast<double>(std::get<1>(item.getPosition()) + item.getDims()[1]);
+}
+
 bool Pallet::isWithinBaseArea(const Item& item) const {
-    // Check if item dimensions fit within pallet base area
-    // Previously used getLength() which doesn't exist. Now using getDepth().
-    return (item.getWidth() <= width_ && item.getDepth() <= length_) ||
-           (item.getDepth() <= width_ && item.getWidth() <= length_);
+    // Footprint in the item's rotation, at its position on the deck; the
+    // deck's width runs along x and its length along z
+    const auto dims = item.getDims();
+    const auto& [x, y, z] = item.getPosition();
+    return x >= 0 && z >= 0 && x + dims[0] <= width_ && z + dims[2] <= length_;
 }
 
 bool Pallet::canAddItem(const Item& item) const {
@@ -34,12 +40,12 @@ bool Pallet::canAddItem(const Item& item) const {
     }
     
     // Check height constraint
-    if (current_height_ + item.getHeight() > max_height_) {
+    if (thickness_ + topOf(item) > max_height_) {
         return false;
     }
     
-    // Check weight constraint - use weight member directly instead of getWeight()
-    if (current_weight_ + item.weight > max_weight_) {
+    // Check weight constraint
+    if (current_weight_ + item.getWeight() > max_weight_) {
         return false;
     }
     
@@ -51,9 +57,12 @@ bool Pallet::addItem(Item* item) {
         return false;
     }
     
+    const double top = topOf(*item);
     items_.push_back(item);
-    current_weight_ += item->weight;  // Access weight directly
-    current_height_ = std::max(current_height_, thickness_ + item->getHeight());
+    item_tops_.push_back(top);
+    current_weight_ += item->getWeight();
+    ++tops_[top];
+    current_height_ = std::max(current_height_, thickness_ + top);
     return true;
 }
 
@@ -62,15 +71,17 @@ void Pallet::removeItem(Item* item) {
     
     auto it = std::find(items_.begin(), items_.end(), item);
     if (it != items_.end()) {
-        current_weight_ -= (*it)->weight;  // Access weight directly
+        // The top recorded on adding, in case the item has moved since
+        const auto index = it - items_.begin();
+        auto top = tops_.find(item_tops_[index]);
+        current_weight_ -= (*it)->getWeight();
         items_.erase(it);
-        
-        // Recalculate current height
-        current_height_ = thickness_;
-        for (const auto& remaining_item : items_) {
-            current_height_ = std::max(current_height_, 
-                thickness_ + remaining_item->getHeight());
+        item_tops_.erase(item_tops_.begin() + index);
+
+        if (top != tops_.end() && --top->second == 0) {
+            tops_.erase(top);
         }
+        current_height_ = tops_.empty() ? thickness_ : thickness_ + tops_.rbegin()->first;
     }
 }
 
@@ -0,0 +1,254 @@
+#include "pallet_packer.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include "log.h"
+
+namespace {
+
+// Pallet measures on the integer grid both stages pack on. Rounded up, so the
+// space a pallet takes in a container covers the real one; the pallet type is
+// rounded once on construction, so stage one loads the same deck that stage
+// two places and reports.
+long deckSize(double size) {
+    return static_cast<long>(std::ceil(size));
+}
+
+// Rotation of `item` that gives exactly `dims`.
+RotationType rotationWithDims(const Item& item, const Dimension& dims) {
+    for (int r = 0; r < 6; ++r) {
+        const auto rotation = static_cast<RotationType>(r);
+        if (item.getDims(rotation) == dims) {
+            return rotation;
+        }
+    }
+    return item.getRotationType();
+}
+
+} // namespace
+
+PalletPacker::PalletPacker(const Pallet& pallet)
+    : pallet_type(deckSize(pallet.getLength()), deckSize(pallet.getWidth()), deckSize(pallet.getThickness()),
+                  pallet.getMaxHeight(), pallet.getMaxWeight()) {}
+
+void PalletPacker::addBin(const Bin& container) {
+    containers.addBin(container);
+}
+
+void PalletPacker::addItem(const Item& carton) {
+    cartons.addItem(carton);
+}
+
+const ItemArena& PalletPacker::getItems() const {
+    return cartons.getItems();
+}
+
+const std::vector<Pallet>& PalletPacker::getPallets() const {
+    return pallets;
+}
+
+int32_t PalletPacker::palletOf(ItemHandle carton) const {
+    return carton < carton_pallet.size() ? carton_pallet[carton] : -1;
+}
+
+const Packer& PalletPacker::getContainers() const {
+    return containers;
+}
+
+bool PalletPacker::truncated() const {
+    return pack_truncated;
+}
+
+bool PalletPacker::fitsPallet(const Item& carton) const {
+    Item probe = carton;
+    probe.setPosition({0, 0, 0});
+    for (RotationType rotation : carton.getAllowedRotations()) {
+        probe.setRotationType(rotation);
+        if (pallet_type.canAddItem(probe)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PalletPacker::pack(const PackOptions& requested) {
+    pallets.clear();
+    carton_pallet.assign(cartons.items.size(), -1);
+    pack_truncated = false;
+    containers.reset();
+
+    // Both stages run against one clock
+    const PackOptions options = startClock(requested, std::chrono::steady_clock::now());
+    buildPallets(options);
+    loadContainers(options);
+}
+
+void PalletPacker::buildPallets(const PackOptions& options) {
+    const long deck_width = deckSize(pallet_type.getWidth());
+    const long deck_length = deckSize(pallet_type.getLength());
+    const long clearance = static_cast<long>(std::floor(pallet_type.getMaxHeight() - pallet_type.getThickness()));
+    const double capacity = fill_target * deck_width * clearance * deck_length;
+    const double max_weight = pallet_type.getMaxWeight();
+
+    std::vector<ItemHandle> pending;
+    for (ItemHandle h = 0; h < cartons.items.size(); ++h) {
+        if (fitsPallet(cartons.items[h])) {
+            pending.push_back(h);
+        }
+    }
+    // Largest first, identical cartons next to each other, so each pallet
+    // takes a run of similar cartons that stack into layers
+    std::sort(pending.begin(), pending.end(), [this](ItemHandle a, ItemHandle b) {
+        const Item& x = cartons.items[a];
+        const Item& y = cartons.items[b];
+        if (x.getVolume() != y.getVolume()) return x.getVolume() > y.getVolume();
+        const auto dx = x.getDims(), dy = y.getDims();
+        if (dx != dy) return dx > dy;
+        return a < b;
+    });
+
+    size_t rounds = 0;
+    while (!pending.empty()) {
+        ++rounds;
+        // Next fit: a pallet takes cartons in order until its share is full
+        std::vector<std::vector<ItemHandle>> loads(1);
+        double volume = 0, weight = 0;
+        for (ItemHandle h : pending) {
+            const Item& carton = cartons.items[h];
+            if (!loads.back().empty() &&
+                (volume + carton.getVolume() > capacity || weight + carton.getWeight() > max_weight)) {
+                loads.emplace_back();
+                volume = weight = 0;
+            }
+            loads.back().push_back(h);
+            volume += carton.getVolume();
+            weight += carton.getWeight();
+        }
+
+        std::vector<Packer> subproblems(loads.size());
+        std::vector<Packer*> queue;
+        for (size_t i = 0; i < loads.size(); ++i) {
+            subproblems[i].addBin(Bin("pallet", deck_width, clearance, deck_length, static_cast<float>(max_weight)));
+            for (ItemHandle h : loads[i]) {
+                subproblems[i].addItem(cartons.items[h]);
+            }
+            queue.push_back(&subproblems[i]);
+        }
+        packMany(queue, options, options.threads);
+
+        std::vector<ItemHandle> leftovers;
+        size_t placed = 0;
+        for (size_t i = 0; i < loads.size(); ++i) {
+            const Packer& load = subproblems[i];
+            pack_truncated = pack_truncated || load.truncated();
+
+            Pallet pallet = pallet_type;
+            std::vector<uint8_t> on_pallet(loads[i].size(), 0);
+            for (ItemHandle local : load.bins[0].getItemHandles()) {
+                Item& carton = cartons.items[loads[i][local]];
+                carton.setRotationType(load.items[local].getRotationType());
+                carton.setPosition(load.items[local].getPosition());
+                on_pallet[local] = pallet.addItem(&carton) ? 1 : 0;
+            }
+            for (size_t local = 0; local < loads[i].size(); ++local) {
+                if (!on_pallet[local]) {
+                    leftovers.push_back(loads[i][local]);
+                }
+            }
+            if (pallet.getItems().empty()) continue;
+            for (const Item* carton : pallet.getItems()) {
+                carton_pallet[carton->input_index] = static_cast<int32_t>(pallets.size());
+            }
+            placed += pallet.getItems().size();
+            pallets.push_back(std::move(pallet));
+        }
+        // Nothing went on a pallet, or time is up: the rest stay unfit
+        if (placed == 0 || pack_truncated) {
+            break;
+        }
+        pending = std::move(leftovers);
+    }
+
+    size_t loaded = 0;
+    for (const auto& pallet : pallets) {
+        loaded += pallet.getItems().size();
+    }
+    log_info("pallet", "loads_built", LogField("pallets", pallets.size()), LogField("rounds", rounds),
+             LogField("cartons", loaded), LogField("unfit", cartons.items.size() - loaded));
+}
+
+void PalletPacker::loadContainers(const PackOptions& options) {
+    const long deck_width = deckSize(pallet_type.getWidth());
+    const long deck_length = deckSize(pallet_type.getLength());
+    for (size_t i = 0; i < pallets.size(); ++i) {
+        const Pallet& pallet = pallets[i];
+        // Pallets stay upright: only a quarter turn about the vertical axis
+        containers.addItem(Item("pallet " + std::to_string(i), deck_width,
+                                static_cast<long>(std::ceil(pallet.getCurrentHeight())), deck_length,
+                                {RotationType::whd, RotationType::dhw}, "#8B4513",
+                                static_cast<float>(pallet.getCurrentWeight()), 0, 0.0f, 0, false, !stack_pallets));
+    }
+    containers.pack(options);
+    pack_truncated = pack_truncated || containers.truncated();
+}
+
+std::vector<int32_t> PalletPacker::palletBins() const {
+    std::vector<int32_t> bin_of(pallets.size(), -1);
+    for (size_t b = 0; b < containers.bins.size(); ++b) {
+        for (ItemHandle handle : containers.bins[b].getItemHandles()) {
+            const size_t pallet = containers.items[handle].input_index;
+            if (pallet < bin_of.size()) {
+                bin_of[pallet] = static_cast<int32_t>(b);
+            }
+        }
+    }
+    return bin_of;
+}
+
+std::vector<std::reference_wrapper<const Item>> PalletPacker::getUnfitItems() const {
+    const auto bin_of = palletBins();
+    std::vector<std::reference_wrapper<const Item>> unfit;
+    for (const auto& carton : cartons.items) {
+        const int32_t pallet = palletOf(carton.input_index);
+        if (pallet < 0 || bin_of[pallet] < 0) {
+            unfit.push_back(std::cref(carton));
+        }
+    }
+    return unfit;
+}
+
+void PalletPacker::writePlacements(int32_t* bin_index, int64_t* position, uint8_t* rotation, int64_t* packed_dims) const {
+    const size_t count = cartons.items.size();
+    std::fill(bin_index, bin_index + count, -1);
+    std::fill(position, position + 3 * count, 0);
+    std::fill(rotation, rotation + count, 0);
+    std::fill(packed_dims, packed_dims + 3 * count, 0);
+
+    const auto bin_of = palletBins();
+    const long deck = deckSize(pallet_type.getThickness());
+    for (const auto& carton : cartons.items) {
+        const size_t row = carton.input_index;
+        const int32_t pallet = palletOf(carton.input_index);
+        if (row >= count || pallet < 0 || bin_of[pallet] < 0) continue;
+
+        const Item& unit = containers.items[pallet];
+        const auto& [px, py, pz] = unit.getPosition();
+        const auto& [x, y, z] = carton.getPosition();
+        auto dims = carton.getDims();
+        RotationType turn = carton.getRotationType();
+        std::array<long, 3> at = {px + x, py + deck + y, pz + z};
+        if (unit.getRotationType() != RotationType::whd) {
+            // Pallet turned a quarter: deck x runs along container z, deck z along x
+            at = {px + z, py + deck + y, pz + unit.getWidth() - x - dims[0]};
+            dims = {dims[2], dims[1], dims[0]};
+            turn = rotationWithDims(carton, dims);
+        }
+
+        bin_index[row] = bin_of[pallet];
+        for (size_t axis = 0; axis < 3; ++axis) {
+            position[3 * row + axis] = at[axis];
+            packed_dims[3 * row + axis] = dims[axis];
+        }
+        rotation[row] = static_cast<uint8_t>(turn);
+    }
+}
@@ -0,0 +1,240 @@
+#include "placed_boxes.h"
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PLACED_BOXES_X86 1
+#include <immintrin.h>
+#endif
+
+void PlacedBoxes::push_back(const Aabb& box, bool disables) {
+    min_x.push_back(box.min[0]);
+    min_y.push_back(box.min[1]);
+    min_z.push_back(box.min[2]);
+    max_x.push_back(box.max[0]);
+    max_y.push_back(box.max[1]);
+    max_z.push_back(box.max[2]);
+    disable_stacking.push_back(disables ? 1 : 0);
+}
+
+void PlacedBoxes::clear() {
+    min_x.clear();
+    min_y.clear();
+    min_z.clear();
+    max_x.clear();
+    max_y.clear();
+    max_z.clear();
+    disable_stacking.clear();
+}
+
+void PlacedBoxes::pop_back() {
+    min_x.pop_back();
+    min_y.pop_back();
+    min_z.pop_back();
+    max_x.pop_back();
+    max_y.pop_back();
+    max_z.pop_back();
+    disable_stacking.pop_back();
+}
+
+namespace {
+
+// Candidate box, pre-split for the kernels.
+struct Query {
+    int64_t min_x, min_y, min_z, max_x, max_y, max_z;
+};
+
+inline bool overlapsAt(const PlacedBoxes& b, size_t i, const Query& q) {
+    return b.min_x[i] < q.max_x && q.min_x < b.max_x[i] &&
+           b.min_y[i] < q.max_y && q.min_y < b.max_y[i] &&
+           b.min_z[i] < q.max_z && q.min_z < b.max_z[i];
+}
+
+bool rangeScalar(const PlacedBoxes& b, const Query& q) {
+    for (size_t i = 0; i < b.size(); ++i) {
+        if (overlapsAt(b, i, q)) return true;
+    }
+    return false;
+}
+
+bool gatherScalar(const PlacedBoxes& b, const Query& q, const uint32_t* ids, size_t count) {
+    for (size_t k = 0; k < count; ++k) {
+        if (overlapsAt(b, ids[k], q)) return true;
+    }
+    return false;
+}
+
+#ifdef PLACED_BOXES_X86
+
+__attribute__((target("avx2")))
+inline __m256i load4(const std::vector<int64_t>& v, size_t i) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.data() + i));
+}
+
+__attribute__((target("avx2")))
+inline __m256i gather4(const std::vector<int64_t>& v, __m256i idx) {
+    return _mm256_i64gather_epi64(reinterpret_cast<const long long*>(v.data()), idx, 8);
+}
+
+__attribute__((target("avx2")))
+inline __m256i overlapMask4(__m256i min_x, __m256i min_y, __m256i min_z,
+                            __m256i max_x, __m256i max_y, __m256i max_z, const Query& q) {
+    // Open intervals on every axis: placed.max > q.min and q.max > placed.min
+    __m256i m = _mm256_and_si256(_mm256_cmpgt_epi64(max_x, _mm256_set1_epi64x(q.min_x)),
+                                 _mm256_cmpgt_epi64(_mm256_set1_epi64x(q.max_x), min_x));
+    m = _mm256_and_si256(m, _mm256_cmpgt_epi64(max_y, _mm256_set1_epi64x(q.min_y)));
+    m = _mm256_and_si256(m, _mm256_cmpgt_epi64(_mm256_set1_epi64x(q.max_y), min_y));
+    m = _mm256_and_si256(m, _mm256_cmpgt_epi64(max_z, _mm256_set1_epi64x(q.min_z)));
+    m = _mm256_and_si256(m, _mm256_cmpgt_epi64(_mm256_set1_epi64x(q.max_z), min_z));
+    return m;
+}
+
+__attribute__((target("avx2")))
+bool rangeAvx2(const PlacedBoxes& b, const Query& q) {
+    const size_t n = b.size();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i m = overlapMask4(load4(b.min_x, i), load4(b.min_y, i), load4(b.min_z, i),
+                                 load4(b.max_x, i), load4(b.max_y, i), load4(b.max_z, i), q);
+        if (!_mm256_testz_si256(m, m)) return true;
+    }
+    for (; i < n; ++i) {
+        if (overlapsAt(b, i, q)) return true;
+    }
+    return false;
+}
+
+__attribute__((target("avx2")))
+bool gatherAvx2(const PlacedBoxes& b, const Query& q, const uint32_t* ids, size_t count) {
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        const __m256i idx = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ids + k)));
+        __m256i m = overlapMask4(gather4(b.min_x, idx), gather4(b.min_y, idx), gather4(b.min_z, idx),
+                                 gather4(b.max_x, idx), gather4(b.max_y, idx), gather4(b.max_z, idx), q);
+        if (!_mm256_testz_si256(m, m)) return true;
+    }
+    for (; k < count; ++k) {
+        if (overlapsAt(b, ids[k], q)) return true;
+    }
+    return false;
+}
+
+__attribute__((target("sse4.2")))
+inline __m128i load2(const std::vector<int64_t>& v, size_t i) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(v.data() + i));
+}
+
+__attribute__((target("sse4.2")))
+inline __m128i gather2(const std::vector<int64_t>& v, uint32_t i0, uint32_t i1) {
+    return _mm_set_epi64x(v[i1], v[i0]);
+}
+
+__attribute__((target("sse4.2")))
+inline __m128i overlapMask2(__m128i min_x, __m128i min_y, __m128i min_z,
+                            __m128i max_x, __m128i max_y, __m128i max_z, const Query& q) {
+    __m128i m = _mm_and_si128(_mm_cmpgt_epi64(max_x, _mm_set1_epi64x(q.min_x)),
+                              _mm_cmpgt_epi64(_mm_set1_epi64x(q.max_x), min_x));
+    m = _mm_and_si128(m, _mm_cmpgt_epi64(max_y, _mm_set1_epi64x(q.min_y)));
+    m = _mm_and_si128(m, _mm_cmpgt_epi64(_mm_set1_epi64x(q.max_y), min_y));
+    m = _mm_and_si128(m, _mm_cmpgt_epi64(max_z, _mm_set1_epi64x(q.min_z)));
+    m = _mm_and_si128(m, _mm_cmpgt_epi64(_mm_set1_epi64x(q.max_z), min_z));
+    return m;
+}
+
+__attribute__((target("sse4.2")))
+bool rangeSse42(const PlacedBoxes& b, const Query& q) {
+    const size_t n = b.size();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i m = overlapMask2(load2(b.min_x, i), load2(b.min_y, i), load2(b.min_z, i),
+                                 load2(b.max_x, i), load2(b.max_y, i), load2(b.max_z, i), q);
+        if (!_mm_testz_si128(m, m)) return true;
+    }
+    for (; i < n; ++i) {
+        if (overlapsAt(b, i, q)) return true;
+    }
+    return false;
+}
+
+__attribute__((target("sse4.2")))
+bool gatherSse42(const PlacedBoxes& b, const Query& q, const uint32_t* ids, size_t count) {
+    size_t k = 0;
+    for (; k + 2 <= count; k += 2) {
+        const uint32_t i0 = ids[k];
+        const uint32_t i1 = ids[k + 1];
+        __m128i m = overlapMask2(gather2(b.min_x, i0, i1), gather2(b.min_y, i0, i1), gather2(b.min_z, i0, i1),
+                                 gather2(b.max_x, i0, i1), gather2(b.max_y, i0, i1), gather2(b.max_z, i0, i1), q);
+        if (!_mm_testz_si128(m, m)) return true;
+    }
+    for (; k < count; ++k) {
+        if (overlapsAt(b, ids[k], q)) return true;
+    }
+    return false;
+}
+
+#endif // PLACED_BOXES_X86
+
+struct Kernels {
+    bool (*range)(const PlacedBoxes&, const Query&);
+    bool (*gather)(const PlacedBoxes&, const Query&, const uint32_t*, size_t);
+    const char* name;
+};
+
+// Every kernel this CPU runs, best first; scalar is always last.
+std::vector<Kernels> supportedKernels() {
+    std::vector<Kernels> supported;
+#ifdef PLACED_BOXES_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        supported.push_back({rangeAvx2, gatherAvx2, "avx2"});
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        supported.push_back({rangeSse42, gatherSse42, "sse4.2"});
+    }
+#endif
+    supported.push_back({rangeScalar, gatherScalar, "scalar"});
+    return supported;
+}
+
+const std::vector<Kernels>& allKernels() {
+    static const std::vector<Kernels> supported = supportedKernels();
+    return supported;
+}
+
+const Kernels& kernels() {
+    return allKernels().front();
+}
+
+Query toQuery(const Aabb& box) {
+    return {box.min[0], box.min[1], box.min[2], box.max[0], box.max[1], box.max[2]};
+}
+
+} // namespace
+
+bool PlacedBoxes::anyOverlap(const Aabb& box) const {
+    return kernels().range(*this, toQuery(box));
+}
+
+bool PlacedBoxes::anyOverlap(const Aabb& box, const uint32_t* ids, size_t count) const {
+    return kernels().gather(*this, toQuery(box), ids, count);
+}
+
+const char* overlapKernelName() {
+    return kernels().name;
+}
+
+std::vector<std::string> overlapKernelNames() {
+    std::vector<std::string> names;
+    for (const auto& kernel : allKernels()) {
+        names.push_back(kernel.name);
+    }
+    return names;
+}
+
+bool anyOverlapWithKernel(const std::string& kernel, const PlacedBoxes& boxes, const Aabb& box,
+                          const uint32_t* ids, size_t count) {
+    for (const auto& candidate : allKernels()) {
+        if (kernel != candidate.name) continue;
+        return ids ? candidate.gather(boxes, toQuery(box), ids, count) : candidate.range(boxes, toQuery(box));
+    }
+    throw std::invalid_argument("unknown overlap kernel: " + kernel);
+}
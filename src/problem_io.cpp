@@ -0,0 +1,460 @@
+#include "problem_io.h"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Nesting deeper than this is rejected rather than recursed into
+constexpr size_t MAX_DEPTH = 64;
+
+struct JsonValue {
+    enum class Type { null, boolean, number, string, array, object };
+    Type type = Type::null;
+    bool boolean = false;
+    double number = 0;
+    std::string text;  // string value
+    std::vector<JsonValue> elements;
+    std::vector<std::pair<std::string, JsonValue>> members;
+    size_t begin = 0, end = 0;  // source span, for echoing values back
+
+    const JsonValue* find(const char* key) const {
+        for (const auto& [name, value] : members) {
+            if (name == key) return &value;
+        }
+        return nullptr;
+    }
+};
+
+[[noreturn]] void fail(const std::string& message) {
+    throw std::invalid_argument(message);
+}
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& source) : source(source) {}
+
+    JsonValue parseDocument() {
+        JsonValue value = parseValue(0);
+        skipSpace();
+        if (at != source.size()) fail("trailing characters after the JSON value");
+        return value;
+    }
+
+private:
+    void skipSpace() {
+        while (at < source.size() && (source[at] == ' ' || source[at] == '\t' || source[at] == '\n' || source[at] == '\r')) {
+            ++at;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (at < source.size() && source[at] == c) {
+            ++at;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) fail(std::string("expected '") + c + "' at offset " + std::to_string(at));
+    }
+
+    JsonValue parseValue(size_t depth) {
+        if (depth > MAX_DEPTH) fail("JSON nested too deeply");
+        skipSpace();
+        if (at >= source.size()) fail("unexpected end of line");
+        JsonValue value;
+        value.begin = at;
+        const char c = source[at];
+        if (c == '{') {
+            ++at;
+            value.type = JsonValue::Type::object;
+            if (!consume('}')) {
+                do {
+                    skipSpace();
+                    std::string key = parseString();
+                    expect(':');
+                    value.members.emplace_back(std::move(key), parseValue(depth + 1));
+                } while (consume(','));
+                expect('}');
+            }
+        } else if (c == '[') {
+            ++at;
+            value.type = JsonValue::Type::array;
+            if (!consume(']')) {
+                do {
+                    value.elements.push_back(parseValue(depth + 1));
+                } while (consume(','));
+                expect(']');
+            }
+        } else if (c == '"') {
+            value.type = JsonValue::Type::string;
+            value.text = parseString();
+        } else if (literal("true")) {
+            value.type = JsonValue::Type::boolean;
+            value.boolean = true;
+        } else if (literal("false")) {
+            value.type = JsonValue::Type::boolean;
+        } else if (literal("null")) {
+            value.type = JsonValue::Type::null;
+        } else {
+            value.type = JsonValue::Type::number;
+            value.number = parseNumber();
+        }
+        value.end = at;
+        return value;
+    }
+
+    bool literal(const char* word) {
+        const size_t length = std::char_traits<char>::length(word);
+        if (source.compare(at, length, word) == 0) {
+            at += length;
+            return true;
+        }
+        return false;
+    }
+
+    double parseNumber() {
+        const size_t start = at;
+        while (at < source.size() && (std::isdigit(static_cast<unsigned char>(source[at])) || source[at] == '-' ||
+                                      source[at] == '+' || source[at] == '.' || source[at] == 'e' || source[at] == 'E')) {
+            ++at;
+        }
+        if (start == at) fail("unexpected character at offset " + std::to_string(at));
+        const std::string digits = source.substr(start, at - start);
+        char* stop = nullptr;
+        const double number = std::strtod(digits.c_str(), &stop);
+        if (stop != digits.c_str() + digits.size()) fail("bad number '" + digits + "'");
+        return number;
+    }
+
+    unsigned parseHex4() {
+        if (at + 4 > source.size()) fail("truncated \\u escape");
+        unsigned code = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char h = source[at++];
+            code <<= 4;
+            if (h >= '0' && h <= '9') code |= h - '0';
+            else if (h >= 'a' && h <= 'f') code |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') code |= h - 'A' + 10;
+            else fail("bad \\u escape");
+        }
+        return code;
+    }
+
+    static void appendUtf8(std::string& out, unsigned code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    std::string parseString() {
+        if (at >= source.size() || source[at] != '"') fail("expected a string at offset " + std::to_string(at));
+        ++at;
+        std::string out;
+        while (true) {
+            if (at >= source.size()) fail("unterminated string");
+            const char c = source[at++];
+            if (c == '"') break;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (at >= source.size()) fail("unterminated string");
+            switch (source[at++]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned code = parseHex4();
+                    // Surrogate pair
+                    if (code >= 0xD800 && code < 0xDC00 && source.compare(at, 2, "\\u") == 0) {
+                        at += 2;
+                        const unsigned low = parseHex4();
+                        if (low < 0xDC00 || low > 0xDFFF) fail("bad surrogate pair");
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default: fail("bad escape in string");
+            }
+        }
+        return out;
+    }
+
+    const std::string& source;
+    size_t at = 0;
+};
+
+double number(const JsonValue& value, const char* what) {
+    if (value.type != JsonValue::Type::number || !std::isfinite(value.number)) {
+        fail(std::string(what) + " must be a number");
+    }
+    return value.number;
+}
+
+double number(const JsonValue& object, const char* key, double fallback) {
+    const JsonValue* value = object.find(key);
+    return value ? number(*value, key) : fallback;
+}
+
+size_t count(const JsonValue& object, const char* key, size_t fallback) {
+    const double value = number(object, key, static_cast<double>(fallback));
+    if (value < 0 || value != std::floor(value)) fail(std::string(key) + " must be a whole number");
+    return static_cast<size_t>(value);
+}
+
+bool flag(const JsonValue& object, const char* key) {
+    const JsonValue* value = object.find(key);
+    if (!value) return false;
+    if (value->type != JsonValue::Type::boolean) fail(std::string(key) + " must be true or false");
+    return value->boolean;
+}
+
+std::string text(const JsonValue& object, const char* key) {
+    const JsonValue* value = object.find(key);
+    if (!value) return "";
+    if (value->type != JsonValue::Type::string) fail(std::string(key) + " must be a string");
+    return value->text;
+}
+
+Dimension size(const JsonValue& object, const char* what) {
+    const JsonValue* value = object.find("size");
+    if (!value || value->type != JsonValue::Type::array || value->elements.size() != 3) {
+        fail(std::string(what) + " needs \"size\": [w, h, d]");
+    }
+    Dimension dims;
+    for (size_t axis = 0; axis < 3; ++axis) {
+        const double extent = number(value->elements[axis], "size");
+        if (extent < 0) fail("size must not be negative");
+        dims[axis] = std::lround(extent);
+    }
+    return dims;
+}
+
+// Index of `name` in `names`, for the enum-valued options.
+template <typename Enum, size_t N>
+Enum choice(const JsonValue& value, const char* key, const char* const (&names)[N]) {
+    if (value.type == JsonValue::Type::string) {
+        for (size_t i = 0; i < N; ++i) {
+            if (value.text == names[i]) return static_cast<Enum>(i);
+        }
+    }
+    std::string allowed;
+    for (size_t i = 0; i < N; ++i) {
+        allowed += (i ? ", " : "") + std::string(names[i]);
+    }
+    fail(std::string(key) + " must be one of " + allowed);
+}
+
+// Names in enum order
+const char* const BIN_SELECTIONS[] = {"first_fit", "best_fill", "fewest_leftovers"};
+const char* const ORDERINGS[] = {"volume", "longest_edge", "base_area", "weight", "random"};
+const char* const OBJECTIVES[] = {"packed_volume", "fewest_bins", "fill_ratio"};
+const char* const ACCEPTANCES[] = {"late_acceptance", "simulated_annealing"};
+
+void parseOptions(const JsonValue& object, PackRequest& request) {
+    if (object.type != JsonValue::Type::object) fail("options must be an object");
+    PackOptions& options = request.options;
+    if (const JsonValue* value = object.find("bin_selection")) {
+        options.bin_selection = choice<BinSelection>(*value, "bin_selection", BIN_SELECTIONS);
+    }
+    if (const JsonValue* value = object.find("ordering")) {
+        options.ordering = choice<ItemOrdering>(*value, "ordering", ORDERINGS);
+    }
+    if (const JsonValue* value = object.find("portfolio")) {
+        if (value->type != JsonValue::Type::array) fail("portfolio must be an array");
+        for (const auto& ordering : value->elements) {
+            options.portfolio.push_back(choice<ItemOrdering>(ordering, "portfolio", ORDERINGS));
+        }
+    }
+    if (const JsonValue* value = object.find("objective")) {
+        options.objective = choice<PackObjective>(*value, "objective", OBJECTIVES);
+    }
+    if (const JsonValue* value = object.find("acceptance")) {
+        options.acceptance = choice<SearchAcceptance>(*value, "acceptance", ACCEPTANCES);
+    }
+    if (object.find("block_building")) {
+        options.block_building = flag(object, "block_building");
+    }
+    options.seed = count(object, "seed", 0);
+    options.random_starts = count(object, "random_starts", 0);
+    options.improve_seconds = number(object, "improve_seconds", 0);
+    options.improve_iterations = count(object, "improve_iterations", 0);
+    options.time_limit = number(object, "time_limit", 0);
+}
+
+void appendEscaped(std::string& out, const std::string& value) {
+    out += '"';
+    for (const char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void appendTriple(std::string& out, long a, long b, long c) {
+    out += '[';
+    out += std::to_string(a);
+    out += ", ";
+    out += std::to_string(b);
+    out += ", ";
+    out += std::to_string(c);
+    out += ']';
+}
+
+void appendHead(std::string& out, const std::string& id, size_t line) {
+    out += '{';
+    if (!id.empty()) {
+        out += "\"id\": ";
+        out += id;
+        out += ", ";
+    }
+    out += "\"line\": ";
+    out += std::to_string(line);
+}
+
+} // namespace
+
+PackRequest parsePackRequest(const std::string& line) {
+    const JsonValue root = JsonParser(line).parseDocument();
+    if (root.type != JsonValue::Type::object) fail("a problem must be a JSON object");
+
+    PackRequest request;
+    if (const JsonValue* id = root.find("id")) {
+        request.id = line.substr(id->begin, id->end - id->begin);
+    }
+
+    const JsonValue* bins = root.find("bins");
+    if (!bins || bins->type != JsonValue::Type::array) fail("a problem needs a \"bins\" array");
+    for (const auto& spec : bins->elements) {
+        if (spec.type != JsonValue::Type::object) fail("each bin must be an object");
+        const Dimension dims = size(spec, "each bin");
+        Bin bin(text(spec, "name"), dims[0], dims[1], dims[2], static_cast<float>(number(spec, "max_weight", 0)));
+        bin.min_support = static_cast<float>(number(spec, "min_support", 0));
+        for (size_t copies = count(spec, "count", 1); copies > 0; --copies) {
+            request.packer.addBin(bin);
+        }
+    }
+
+    const JsonValue* items = root.find("items");
+    if (!items || items->type != JsonValue::Type::array) fail("a problem needs an \"items\" array");
+    std::vector<RotationType> rotations;
+    for (const auto& spec : items->elements) {
+        if (spec.type != JsonValue::Type::object) fail("each item must be an object");
+        rotations.clear();
+        if (const JsonValue* allowed = spec.find("rotations")) {
+            if (allowed->type != JsonValue::Type::array) fail("rotations must be an array");
+            for (const auto& rotation : allowed->elements) {
+                const double r = number(rotation, "rotations");
+                if (r < 0 || r > 5 || r != std::floor(r)) fail("rotations must be RotationType values 0 to 5");
+                rotations.push_back(static_cast<RotationType>(static_cast<int>(r)));
+            }
+        }
+        const uint8_t flags = (flag(spec, "bottom_load_only") ? ITEM_BOTTOM_LOAD_ONLY : 0) |
+                              (flag(spec, "disable_stacking") ? ITEM_DISABLE_STACKING : 0);
+        request.packer.addItemType(size(spec, "each item"), rotations, flags,
+                                   static_cast<float>(number(spec, "weight", 0)), count(spec, "quantity", 1),
+                                   text(spec, "name"));
+    }
+
+    if (const JsonValue* options = root.find("options")) {
+        parseOptions(*options, request);
+    }
+    return request;
+}
+
+std::string formatPackResult(const PackRequest& request, size_t line, double seconds) {
+    const Packer& packer = request.packer;
+    std::string out;
+    out.reserve(64 + 80 * packer.items.size());
+    appendHead(out, request.id, line);
+    out += ", \"bins\": [";
+    bool first_bin = true;
+    for (const auto& bin : packer.bins) {
+        if (bin.itemCount() == 0) continue;
+        out += first_bin ? "{" : ", {";
+        first_bin = false;
+        out += "\"name\": ";
+        appendEscaped(out, bin.getName());
+        out += ", \"size\": ";
+        appendTriple(out, bin.getWidth(), bin.getHeight(), bin.getDepth());
+        out += ", \"items\": [";
+        bool first_item = true;
+        for (ItemHandle handle : bin.getItemHandles()) {
+            const Item& item = packer.items[handle];
+            const auto& [x, y, z] = item.getPosition();
+            const auto dims = item.getDims();
+            out += first_item ? "{\"item\": " : ", {\"item\": ";
+            first_item = false;
+            out += std::to_string(item.input_index);
+            out += ", \"position\": ";
+            appendTriple(out, x, y, z);
+            out += ", \"rotation\": ";
+            out += std::to_string(static_cast<int>(item.getRotationType()));
+            out += ", \"size\": ";
+            appendTriple(out, dims[0], dims[1], dims[2]);
+            out += '}';
+        }
+        out += "]}";
+    }
+    out += "], \"unfit\": [";
+    for (size_t i = 0; i < packer.unfit_items.size(); ++i) {
+        if (i) out += ", ";
+        out += std::to_string(packer.unfit_items[i]);
+    }
+    out += "], \"truncated\": ";
+    out += packer.truncated() ? "true" : "false";
+    char timing[32];
+    std::snprintf(timing, sizeof(timing), "%.6f", seconds);
+    out += ", \"seconds\": ";
+    out += timing;
+    out += '}';
+    return out;
+}
+
+std::string formatPackError(const std::string& id, size_t line, const std::string& message) {
+    std::string out;
+    appendHead(out, id, line);
+    out += ", \"error\": ";
+    appendEscaped(out, message);
+    out += '}';
+    return out;
+}
@@ -1,15 +1,172 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/operators.h>  // Include this header for py::self
+#include <pybind11/numpy.h>
+#include <chrono>
+#include <cstdio>
+#include <future>
 #include <sstream>
+#include <thread>
 #include "box.h"
 #include "item.h"
 #include "bin.h"
 #include "packer.h"
+#include "pallet.h"
+#include "pallet_packer.h"
+#include "result_cache.h"
+#include "log.h"
+#include "thread_pool.h"
 
 namespace py = pybind11;
 
+namespace {
+
+// Shared pool for pack_async, leaked on purpose. Its jobs capture a raw
+// Packer*; only the PackFuture's py::object keeps that packer alive. As a
+// static the pool would be destroyed after the interpreter is finalized, and
+// its destructor drains queued jobs, which would then pack through pointers to
+// Python objects that finalization may already have freed. Leaked, its
+// workers just stay asleep on their condition variable until the process exits.
+ThreadPool& asyncPool() {
+    static ThreadPool* pool = new ThreadPool();
+    return *pool;
+}
+
+// Handle for a pack running in the background. Holds a reference to the
+// Python Packer so it stays alive until the pack finishes.
+struct PackFuture {
+    py::object packer;
+    std::shared_future<void> done;
+    CancelToken cancel_token;  // the running pack's own, linked to the caller's
+
+    // Dropping the handle early must not free the packer under a running job
+    ~PackFuture() {
+        if (done.valid() && !isDone()) {
+            py::gil_scoped_release release;
+            done.wait();
+        }
+    }
+
+    bool isDone() const {
+        return done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    py::object result() const {
+        {
+            py::gil_scoped_release release;
+            done.wait();
+        }
+        done.get();  // rethrows a failed pack
+        return packer;
+    }
+};
+
+// Packs on a helper thread while this one waits without the GIL, waking to
+// check for Python signals. A pending KeyboardInterrupt (or any signal handler
+// that raises) cancels the pack, which then stops within a few candidate
+// positions, and is re-raised here. The pack runs on a token linked to the
+// caller's, so the interrupt does not leave their options cancelled.
+template <typename P>
+void packInterruptible(P& packer, const PackOptions& caller_options) {
+    constexpr auto SIGNAL_POLL = std::chrono::milliseconds(20);
+    PackOptions options = caller_options;
+    options.cancel_token = caller_options.cancel_token.linked();
+    std::promise<void> finished;
+    auto done = finished.get_future();
+    bool interrupted = false;
+    {
+        py::gil_scoped_release release;
+        std::thread worker([&packer, &options, &finished]() {
+            try {
+                packer.pack(options);
+                finished.set_value();
+            } catch (...) {
+                finished.set_exception(std::current_exception());
+            }
+        });
+        while (done.wait_for(SIGNAL_POLL) != std::future_status::ready) {
+            if (interrupted) continue;
+            py::gil_scoped_acquire acquire;
+            if (PyErr_CheckSignals() != 0) {
+                interrupted = true;
+                options.cancel_token.cancel();
+            }
+        }
+        worker.join();
+    }
+    if (interrupted) {
+        throw py::error_already_set();
+    }
+    done.get();
+}
+
+template <typename T>
+using InputArray = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+// Optional per-item column: null when absent, otherwise must have one entry per item.
+template <typename T>
+const T* column(const std::optional<InputArray<T>>& array, size_t count, const char* name) {
+    if (!array) {
+        return nullptr;
+    }
+    if (array->ndim() != 1 || static_cast<size_t>(array->shape(0)) != count) {
+        throw py::value_error(std::string(name) + " must be a 1-D array with one entry per item");
+    }
+    return array->data();
+}
+
+void addItemsArray(Packer& packer, const InputArray<int64_t>& dims,
+                   const std::optional<InputArray<float>>& weights,
+                   const std::optional<InputArray<uint8_t>>& flags,
+                   const std::optional<InputArray<uint8_t>>& rotation_masks) {
+    if (dims.ndim() != 2 || dims.shape(1) != 3) {
+        throw py::value_error("dims must be an N x 3 array of (w, h, d)");
+    }
+    const size_t count = static_cast<size_t>(dims.shape(0));
+    packer.addItems(count, dims.data(), column(weights, count, "weights"),
+                    column(flags, count, "flags"), column(rotation_masks, count, "rotation_masks"));
+}
+
+// Copies, like the std::vector<Item> this used to return.
+std::vector<Item> packerItems(const Packer& packer) {
+    return {packer.getItems().begin(), packer.getItems().end()};
+}
+
+// Copies of the packer's bins that share one copy of its items, so they
+// stay valid after the packer is changed or collected.
+std::vector<Bin> detachedBins(const Packer& packer) {
+    auto items = std::make_shared<ItemArena>(packer.getItems());
+    std::vector<Bin> bins = packer.getBins();
+    for (auto& bin : bins) {
+        bin.attach(items);
+    }
+    return bins;
+}
+
+template <typename P>
+py::dict placementsArray(const P& packer) {
+    const py::ssize_t count = static_cast<py::ssize_t>(packer.getItems().size());
+    py::array_t<int32_t> bin_index(count);
+    py::array_t<int64_t> position({count, py::ssize_t(3)});
+    py::array_t<uint8_t> rotation(count);
+    py::array_t<int64_t> packed_dims({count, py::ssize_t(3)});
+    packer.writePlacements(bin_index.mutable_data(), position.mutable_data(),
+                           rotation.mutable_data(), packed_dims.mutable_data());
+
+    py::dict result;
+    result["bin_index"] = bin_index;
+    result["position"] = position;
+    result["rotation"] = rotation;
+    result["dimension"] = packed_dims;
+    return result;
+}
+
+} // namespace
+
 PYBIND11_MODULE(pybinding, m) {
+    m.attr("ITEM_BOTTOM_LOAD_ONLY") = ITEM_BOTTOM_LOAD_ONLY;
+    m.attr("ITEM_DISABLE_STACKING") = ITEM_DISABLE_STACKING;
+
     py::class_<Box>(m, "Box")
         .def(py::init<const std::string&, long, long, long>())
         .def("get_name", &Box::getName)
@@ -31,7 +188,7 @@ PYBIND11_MODULE(pybinding, m) {
         .value("height", Axis::height)
         .value("depth", Axis::depth);
 
-    py::class_<Item, Box>(m, "Item")
+    py::class_<Item>(m, "Item")
         .def(py::init([](const std::string& name, long w, long h, long d) {
             return new Item(name, w, h, d);
         }))
@@ -69,6 +226,10 @@ PYBIND11_MODULE(pybinding, m) {
         }))
         .def(py::init<const std::string&, long, long, long, const std::vector<RotationType>&, const std::string&>())
         .def("get_name", &Item::getName)
+        .def("get_width", &Item::getWidth)
+        .def("get_height", &Item::getHeight)
+        .def("get_depth", &Item::getDepth)
+        .def("get_volume", &Item::getVolume)
         .def("get_allowed_rotations", &Item::getAllowedRotations)
         .def("get_rotation_type", &Item::getRotationType)
         .def("set_rotation_type", &Item::setRotationType)
@@ -83,20 +244,36 @@ PYBIND11_MODULE(pybinding, m) {
             oss << item;
             return oss.str();
         })
-        .def_readwrite("color", &Item::color)
-        .def_readwrite("width", &Item::width)
-        .def_readwrite("height", &Item::height)
-        .def_readwrite("depth", &Item::depth)
-        .def_readwrite("allowed_rotations", &Item::_allowed_rotations)
+        // Type data is shared between units of a SKU; setters copy it first
+        .def_property("color", &Item::getColor, &Item::setColor)
+        .def_property("width", &Item::getWidth, &Item::setWidth)
+        .def_property("height", &Item::getHeight, &Item::setHeight)
+        .def_property("depth", &Item::getDepth, &Item::setDepth)
+        .def_property("allowed_rotations", &Item::getAllowedRotations, &Item::setAllowedRotations)
         .def_readwrite("position", &Item::_position, py::return_value_policy::reference)
         .def_readwrite("rotation_type", &Item::_rotation_type)
-        .def_readwrite("name", &Item::name, py::return_value_policy::reference)
-        .def_readwrite("weight", &Item::weight)
-        .def_readwrite("stuffing_height", &Item::stuffing_height)
-        .def_readwrite("stuffing_max_weight", &Item::stuffing_max_weight)
-        .def_readwrite("stuffing_layers", &Item::stuffing_layers)
-        .def_readwrite("bottom_load_only", &Item::bottom_load_only)
-        .def_readwrite("disable_stacking", &Item::disable_stacking);
+        .def_property("name", &Item::getName, &Item::setName)
+        .def_property("weight", &Item::getWeight, &Item::setWeight)
+        .def_property("stuffing_height", &Item::getStuffingHeight, &Item::setStuffingHeight)
+        .def_property("stuffing_max_weight", &Item::getStuffingMaxWeight, &Item::setStuffingMaxWeight)
+        .def_property("stuffing_layers", &Item::getStuffingLayers, &Item::setStuffingLayers)
+        .def_property("bottom_load_only", &Item::bottomLoadOnly, &Item::setBottomLoadOnly)
+        .def_property("disable_stacking", &Item::disablesStacking, &Item::setDisableStacking)
+        .def_readwrite("input_index", &Item::input_index);
+
+    py::class_<CogEnvelope>(m, "CogEnvelope")
+        .def(py::init<>())
+        .def(py::init([](const std::array<double, 3>& min, const std::array<double, 3>& max) {
+                 return CogEnvelope{true, min, max};
+             }),
+             py::arg("min"), py::arg("max"))
+        .def_readwrite("enabled", &CogEnvelope::enabled)
+        .def_readwrite("min", &CogEnvelope::min)
+        .def_readwrite("max", &CogEnvelope::max);
+
+    py::class_<BinMark>(m, "BinMark")
+        .def_readonly("items", &BinMark::items)
+        .def_readonly("depth", &BinMark::depth);
 
     py::class_<Bin, Box>(m, "Bin")
         .def(py::init<const std::string&, long, long, long, float, const std::string&, const std::string&, int>(),
@@ -104,33 +281,256 @@ PYBIND11_MODULE(pybinding, m) {
              py::arg("image") = "", py::arg("description") = "", py::arg("id") = 0)
         .def("get_items", &Bin::getItems)
         .def("set_items", &Bin::setItems)
+        .def("fits_rotation", &Bin::fitsRotation)
         .def("score_rotation", &Bin::scoreRotation)
         .def("get_best_rotation_order", &Bin::getBestRotationOrder)
+        .def("get_rotation_plan", [](const Bin& bin, const Item& item) {
+            const auto& plan = bin.getRotationPlan(item);
+            return std::vector<RotationType>(plan.begin(), plan.end());
+        })
         .def("put_item", &Bin::putItem)
-        .def_readwrite("items", &Bin::items)
+        .def("get_extreme_points", &Bin::getExtremePoints)
+        .def("support_ratio", &Bin::supportRatio)
+        .def("mark", &Bin::mark)
+        .def("rollback", &Bin::rollback)
+        .def("commit", &Bin::commit)
+        .def_property_readonly("items", &Bin::getItems)
+        .def_readonly("item_handles", &Bin::items)
         .def_readwrite("name", &Box::name, py::return_value_policy::reference)
         .def_readwrite("width", &Box::width)
         .def_readwrite("height", &Box::height)
         .def_readwrite("depth", &Box::depth)
         .def_readwrite("max_weight", &Bin::max_weight)
+        .def_readwrite("min_support", &Bin::min_support)
+        .def_readwrite("axle_z", &Bin::axle_z)
+        .def_readwrite("cog_envelope", &Bin::cog_envelope)
+        .def_property_readonly("load_weight", &Bin::getLoadWeight)
+        .def_property_readonly("load_volume", &Bin::getLoadVolume)
+        .def_property_readonly("fill_ratio", &Bin::getFillRatio)
+        .def_property_readonly("centre_of_gravity", &Bin::getCentreOfGravity)
+        .def_property_readonly("axle_loads", &Bin::getAxleLoads)
         .def_readwrite("image", &Bin::image)
         .def_readwrite("description", &Bin::description)
         .def_readwrite("id", &Bin::id)
         .def("to_string", &Bin::toString);
 
+    py::enum_<BinSelection>(m, "BinSelection")
+        .value("first_fit", BinSelection::first_fit)
+        .value("best_fill", BinSelection::best_fill)
+        .value("fewest_leftovers", BinSelection::fewest_leftovers);
+
+    py::enum_<ItemOrdering>(m, "ItemOrdering")
+        .value("volume", ItemOrdering::volume)
+        .value("longest_edge", ItemOrdering::longest_edge)
+        .value("base_area", ItemOrdering::base_area)
+        .value("weight", ItemOrdering::weight)
+        .value("random", ItemOrdering::random);
+
+    py::enum_<PackObjective>(m, "PackObjective")
+        .value("packed_volume", PackObjective::packed_volume)
+        .value("fewest_bins", PackObjective::fewest_bins)
+        .value("fill_ratio", PackObjective::fill_ratio);
+
+    py::enum_<SearchAcceptance>(m, "SearchAcceptance")
+        .value("late_acceptance", SearchAcceptance::late_acceptance)
+        .value("simulated_annealing", SearchAcceptance::simulated_annealing);
+
+    py::class_<CancelToken>(m, "CancelToken")
+        .def(py::init<>())
+        .def("cancel", &CancelToken::cancel)
+        .def("cancelled", &CancelToken::cancelled);
+
+    py::class_<PackOptions>(m, "PackOptions")
+        .def(py::init<>())
+        .def_readwrite("bin_selection", &PackOptions::bin_selection)
+        .def_readwrite("threads", &PackOptions::threads)
+        .def_readwrite("ordering", &PackOptions::ordering)
+        .def_readwrite("seed", &PackOptions::seed)
+        .def_readwrite("portfolio", &PackOptions::portfolio)
+        .def_readwrite("random_starts", &PackOptions::random_starts)
+        .def_readwrite("objective", &PackOptions::objective)
+        .def_readwrite("block_building", &PackOptions::block_building)
+        .def_readwrite("improve_seconds", &PackOptions::improve_seconds)
+        .def_readwrite("improve_iterations", &PackOptions::improve_iterations)
+        .def_readwrite("acceptance", &PackOptions::acceptance)
+        // Seconds from the start of each pack, or None without a limit
+        .def_property("time_limit",
+                      [](const PackOptions& options) -> std::optional<double> {
+                          if (options.time_limit <= 0) {
+                              return std::nullopt;
+                          }
+                          return options.time_limit;
+                      },
+                      [](PackOptions& options, std::optional<double> seconds) {
+                          options.time_limit = seconds ? *seconds : 0;
+                      })
+        .def_readwrite("cancel_token", &PackOptions::cancel_token);
+
+    py::class_<PackStats>(m, "PackStats")
+        .def_readonly("put_attempts", &PackStats::put_attempts)
+        .def_readonly("put_accepted", &PackStats::put_accepted)
+        .def_readonly("rejected_out_of_bounds", &PackStats::rejected_out_of_bounds)
+        .def_readonly("rejected_bottom_load_only", &PackStats::rejected_bottom_load_only)
+        .def_readonly("rejected_disable_stacking", &PackStats::rejected_disable_stacking)
+        .def_readonly("rejected_overlap", &PackStats::rejected_overlap)
+        .def_readonly("rejected_unsupported", &PackStats::rejected_unsupported)
+        .def_readonly("rejected_overweight", &PackStats::rejected_overweight)
+        .def_readonly("rejected_off_balance", &PackStats::rejected_off_balance)
+        .def_readonly("candidates_start", &PackStats::candidates_start)
+        .def_readonly("candidates_extreme_point", &PackStats::candidates_extreme_point)
+        .def_readonly("blocks_placed", &PackStats::blocks_placed)
+        .def_readonly("block_units", &PackStats::block_units)
+        .def_readonly("bins_tried", &PackStats::bins_tried)
+        .def_readonly("bin_trials", &PackStats::bin_trials)
+        .def_readonly("packs_run", &PackStats::packs_run)
+        .def_readonly("prefiltered_unfit", &PackStats::prefiltered_unfit)
+        .def_readonly("improve_moves", &PackStats::improve_moves)
+        .def_readonly("improve_accepted", &PackStats::improve_accepted)
+        .def_readonly("improve_best", &PackStats::improve_best)
+        .def_readonly("seconds_ordering", &PackStats::seconds_ordering)
+        .def_readonly("seconds_bin_selection", &PackStats::seconds_bin_selection)
+        .def_readonly("seconds_packing", &PackStats::seconds_packing)
+        .def_readonly("seconds_improving", &PackStats::seconds_improving)
+        .def_readonly("seconds_total", &PackStats::seconds_total);
+
+    py::class_<BinBounds>(m, "BinBounds")
+        .def_readonly("volume", &BinBounds::volume)
+        .def_readonly("weight", &BinBounds::weight)
+        .def_readonly("l1", &BinBounds::l1)
+        .def_readonly("l2", &BinBounds::l2)
+        .def_readonly("unfit", &BinBounds::unfit)
+        .def_property_readonly("lower", &BinBounds::lower);
+
+    py::class_<Placement>(m, "Placement")
+        .def_readonly("item", &Placement::item)
+        .def_readonly("bin", &Placement::bin)
+        .def_readonly("position", &Placement::position)
+        .def_readonly("rotation", &Placement::rotation)
+        .def_readonly("opened_bin", &Placement::opened_bin)
+        .def_property_readonly("placed", &Placement::placed);
+
     py::class_<Packer>(m, "Packer")
         .def(py::init<>())
-        .def("get_bins", &Packer::getBins)
-        .def("get_items", &Packer::getItems)
+        .def("get_bins", &detachedBins)
+        .def("get_items", &packerItems)
         .def("get_unfit_items", &Packer::getUnfitItems)
-        .def("add_bin", &Packer::addBin)
-        .def("add_item", &Packer::addItem)
+        .def("add_bin", py::overload_cast<const Bin&>(&Packer::addBin))
+        .def("add_item", py::overload_cast<const Item&>(&Packer::addItem))
+        .def("reset", &Packer::reset)
+        .def("add_item_type", &Packer::addItemType, py::arg("dims"), py::arg("rotations") = std::vector<RotationType>{}, py::arg("flags") = 0,
+             py::arg("weight") = 0.0f, py::arg("quantity") = 1, py::arg("name") = "",
+             py::arg("color") = "#000000")
+        .def("item_type_count", [](const Packer& packer) { return packer.getItemTypes().size(); })
         .def("find_fitted_bin", &Packer::findFittedBin)
         .def("get_bigger_bin_than", &Packer::getBiggerBinThan)
         .def("unfit_item", &Packer::unfitItem)
         .def("pack_to_bin", &Packer::packToBin)
-        .def("pack", &Packer::pack)
-        .def_readwrite("bins", &Packer::bins)
-        .def_readwrite("items", &Packer::items)
-        .def_readwrite("unfit_items", &Packer::unfit_items);
+        .def("pack", [](Packer& packer) { packInterruptible(packer, PackOptions{}); })
+        .def("pack", &packInterruptible<Packer>)
+        .def("place", &Packer::place, py::arg("item"), py::arg("open_bin") = true)
+        .def("truncated", &Packer::truncated)
+        .def("bounds", &Packer::bounds)
+        .def("clone_problem", &Packer::cloneProblem)
+        .def("add_items_array", &addItemsArray, py::arg("dims"), py::arg("weights") = py::none(),
+             py::arg("flags") = py::none(), py::arg("rotation_masks") = py::none())
+        .def("placements_array", &placementsArray<Packer>)
+        .def("stats", &Packer::stats, py::return_value_policy::copy)
+        .def_property("bins", &detachedBins,
+                      [](Packer& packer, const std::vector<Bin>& bins) {
+                          packer.bins.clear();
+                          for (const auto& bin : bins) {
+                              packer.addBin(bin);
+                          }
+                      })
+        .def_property_readonly("items", &packerItems)
+        .def_property_readonly("unfit_items", &Packer::getUnfitItems);
+
+    py::class_<Pallet>(m, "Pallet")
+        .def(py::init<double, double, double, double, double>(),
+             py::arg("length"), py::arg("width"), py::arg("thickness"), py::arg("max_height"), py::arg("max_weight"))
+        .def("can_add_item", &Pallet::canAddItem)
+        .def("get_available_height", &Pallet::getAvailableHeight)
+        .def("get_available_weight", &Pallet::getAvailableWeight)
+        .def_property_readonly("length", &Pallet::getLength)
+        .def_property_readonly("width", &Pallet::getWidth)
+        .def_property_readonly("thickness", &Pallet::getThickness)
+        .def_property_readonly("max_height", &Pallet::getMaxHeight)
+        .def_property_readonly("max_weight", &Pallet::getMaxWeight)
+        .def_property_readonly("current_height", &Pallet::getCurrentHeight)
+        .def_property_readonly("current_weight", &Pallet::getCurrentWeight)
+        .def_property_readonly("items", [](const Pallet& pallet) {
+            std::vector<Item> items;
+            for (const Item* item : pallet.getItems()) {
+                items.push_back(*item);
+            }
+            return items;
+        });
+
+    py::class_<PalletPacker>(m, "PalletPacker")
+        .def(py::init<const Pallet&>(), py::arg("pallet"))
+        .def("add_bin", &PalletPacker::addBin)
+        .def("add_item", &PalletPacker::addItem)
+        .def("pack", [](PalletPacker& packer) { packInterruptible(packer, PackOptions{}); })
+        .def("pack", &packInterruptible<PalletPacker>)
+        .def("truncated", &PalletPacker::truncated)
+        .def("pallet_of", &PalletPacker::palletOf)
+        .def("placements_array", &placementsArray<PalletPacker>)
+        .def_readwrite("fill_target", &PalletPacker::fill_target)
+        .def_readwrite("stack_pallets", &PalletPacker::stack_pallets)
+        .def_property_readonly("pallets", &PalletPacker::getPallets)
+        .def_property_readonly("containers", &PalletPacker::getContainers, py::return_value_policy::reference_internal)
+        .def_property_readonly("items", [](const PalletPacker& packer) {
+            return std::vector<Item>(packer.getItems().begin(), packer.getItems().end());
+        })
+        .def_property_readonly("unfit_items", &PalletPacker::getUnfitItems);
+
+    py::class_<ResultCache>(m, "ResultCache")
+        .def(py::init<size_t>(), py::arg("max_bytes") = size_t(64u << 20))
+        .def("open_file", &ResultCache::openFile, py::arg("path"), py::arg("file_bytes") = size_t(256u << 20),
+             py::call_guard<py::gil_scoped_release>())
+        .def("close_file", &ResultCache::closeFile, py::call_guard<py::gil_scoped_release>())
+        .def("pack", &ResultCache::pack, py::arg("packer"), py::arg("options") = PackOptions{},
+             py::call_guard<py::gil_scoped_release>())
+        .def("clear", &ResultCache::clear)
+        .def_property_readonly("hits", &ResultCache::hits)
+        .def_property_readonly("misses", &ResultCache::misses)
+        .def_property_readonly("size", &ResultCache::size)
+        .def_property_readonly("bytes", &ResultCache::bytes);
+
+    // Canonical problem hash as 32 hex digits, optionally with the options.
+    m.def("problem_hash", [](const Packer& packer, std::optional<PackOptions> options) {
+              const ProblemHash hash = options ? problemHash(packer, *options) : problemHash(packer);
+              char text[33];
+              std::snprintf(text, sizeof(text), "%016llx%016llx", static_cast<unsigned long long>(hash.high),
+                            static_cast<unsigned long long>(hash.low));
+              return std::string(text);
+          },
+          py::arg("packer"), py::arg("options") = py::none());
+
+    py::class_<PackFuture>(m, "PackFuture")
+        .def("done", &PackFuture::isDone)
+        .def("result", &PackFuture::result)
+        .def("cancel", [](PackFuture& future) { future.cancel_token.cancel(); });
+
+    // Log records are queued per thread and written by a background thread.
+    m.def("enable_log", &enable_log, py::arg("enable"));
+    m.def("flush_log", &flush_log, py::call_guard<py::gil_scoped_release>());
+
+    // The packers must not be touched from Python until these return.
+    m.def("pack_many", [](const std::vector<Packer*>& packers, size_t threads, const PackOptions& options) {
+              py::gil_scoped_release release;
+              packMany(packers, options, threads);
+          },
+          py::arg("packers"), py::arg("threads") = 0, py::arg("options") = PackOptions{});
+
+    m.def("pack_async", [](py::object packer_obj, PackOptions options) {
+              Packer* packer = packer_obj.cast<Packer*>();
+              // Cancelling the future stops this pack only, not the caller's token
+              options.cancel_token = options.cancel_token.linked();
+              // The limit counts from submission, not from when a worker frees up
+              options = startClock(options, std::chrono::steady_clock::now());
+              auto done = asyncPool().submit([packer, options]() { packer->pack(options); });
+              return PackFuture{std::move(packer_obj), done.share(), options.cancel_token};
+          },
+          py::arg("packer"), py::arg("options") = PackOptions{});
 }
@@ -0,0 +1,564 @@
+#include "result_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+#include "log.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RESULT_CACHE_MMAP 1
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr char FILE_MAGIC[8] = {'B', 'P', 'C', 'A', 'C', 'H', 'E', '1'};
+constexpr size_t HEADER_BYTES = 32;  // magic, capacity, end of the last record, spare
+constexpr size_t RECORD_BYTES = 32;  // key high, key low, payload size, checksum
+// Rough per-entry cost of the list node and map slot on top of the payload
+constexpr size_t ENTRY_OVERHEAD = sizeof(std::pair<ProblemHash, void*>) + 64;
+
+// splitmix64 finalizer
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Two independently seeded lanes, fed the same words
+struct Digest {
+    uint64_t high = 0x6a09e667f3bcc908ULL;
+    uint64_t low = 0xbb67ae8584caa73bULL;
+
+    void add(uint64_t value) {
+        high = mix(high ^ value);
+        low = mix(low + ((value << 32) | (value >> 32)) + 0x9e3779b97f4a7c15ULL);
+    }
+    void add(const ProblemHash& hash) {
+        add(hash.high);
+        add(hash.low);
+    }
+    void addReal(double value) {
+        if (value == 0) value = 0;  // -0 and 0 alike
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        add(bits);
+    }
+    ProblemHash done() const { return {mix(high), mix(low)}; }
+};
+
+bool before(const ProblemHash& a, const ProblemHash& b) {
+    return a.high != b.high ? a.high < b.high : a.low < b.low;
+}
+
+ProblemHash typeDigest(const ItemType& type) {
+    Digest digest;
+    digest.add(static_cast<uint64_t>(type.width));
+    digest.add(static_cast<uint64_t>(type.height));
+    digest.add(static_cast<uint64_t>(type.depth));
+    uint64_t rotations = 0;
+    for (RotationType rotation : type.allowed_rotations) {
+        rotations |= 1u << static_cast<unsigned>(rotation);
+    }
+    digest.add(rotations);
+    digest.add((type.bottom_load_only ? ITEM_BOTTOM_LOAD_ONLY : 0) | (type.disable_stacking ? ITEM_DISABLE_STACKING : 0));
+    digest.addReal(type.weight);
+    return digest.done();
+}
+
+ProblemHash binDigest(const Bin& bin) {
+    Digest digest;
+    digest.add(static_cast<uint64_t>(bin.getWidth()));
+    digest.add(static_cast<uint64_t>(bin.getHeight()));
+    digest.add(static_cast<uint64_t>(bin.getDepth()));
+    digest.addReal(bin.max_weight);
+    digest.addReal(bin.min_support);
+    digest.addReal(bin.axle_z[0]);
+    digest.addReal(bin.axle_z[1]);
+    digest.add(bin.cog_envelope.enabled ? 1 : 0);
+    if (bin.cog_envelope.enabled) {
+        for (size_t axis = 0; axis < 3; ++axis) {
+            digest.addReal(bin.cog_envelope.min[axis]);
+            digest.addReal(bin.cog_envelope.max[axis]);
+        }
+    }
+    return digest.done();
+}
+
+// Handles of packer's items in canonical order, and the hash of the
+// sequence of their digests in that order.
+std::pair<std::vector<ItemHandle>, ProblemHash> canonicalItems(const Packer& packer) {
+    std::unordered_map<const ItemType*, ProblemHash> digests;
+    std::vector<std::pair<ProblemHash, ItemHandle>> keyed;
+    keyed.reserve(packer.items.size());
+    for (const auto& item : packer.items) {
+        auto [slot, added] = digests.try_emplace(&item.getType());
+        if (added) {
+            slot->second = typeDigest(item.getType());
+        }
+        keyed.emplace_back(slot->second, item.input_index);
+    }
+    std::sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? before(a.first, b.first) : a.second < b.second;
+    });
+
+    Digest digest;
+    digest.add(keyed.size());
+    std::vector<ItemHandle> order;
+    order.reserve(keyed.size());
+    for (const auto& [key, handle] : keyed) {
+        digest.add(key);
+        order.push_back(handle);
+    }
+    return {std::move(order), digest.done()};
+}
+
+// Same for packer's bins, by index into packer.bins.
+std::pair<std::vector<uint32_t>, ProblemHash> canonicalBins(const Packer& packer) {
+    std::vector<std::pair<ProblemHash, uint32_t>> keyed;
+    for (uint32_t b = 0; b < packer.bins.size(); ++b) {
+        keyed.emplace_back(binDigest(packer.bins[b]), b);
+    }
+    std::sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? before(a.first, b.first) : a.second < b.second;
+    });
+
+    Digest digest;
+    digest.add(keyed.size());
+    std::vector<uint32_t> order;
+    for (const auto& [key, index] : keyed) {
+        digest.add(key);
+        order.push_back(index);
+    }
+    return {std::move(order), digest.done()};
+}
+
+ProblemHash combine(const ProblemHash& items, const ProblemHash& bins) {
+    Digest digest;
+    digest.add(items);
+    digest.add(bins);
+    return digest.done();
+}
+
+ProblemHash withOptions(const ProblemHash& problem, const PackOptions& options) {
+    Digest digest;
+    digest.add(problem);
+    digest.add(static_cast<uint64_t>(options.bin_selection));
+    digest.add(static_cast<uint64_t>(options.ordering));
+    digest.add(options.seed);
+    digest.add(options.portfolio.size());
+    for (auto ordering : options.portfolio) {
+        digest.add(static_cast<uint64_t>(ordering));
+    }
+    digest.add(options.random_starts);
+    digest.add(static_cast<uint64_t>(options.objective));
+    digest.add(options.block_building ? 1 : 0);
+    digest.addReal(options.improve_seconds);
+    digest.add(options.improve_iterations);
+    digest.add(static_cast<uint64_t>(options.acceptance));
+    return digest.done();
+}
+
+uint64_t checksum(const uint8_t* data, size_t size) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void put(std::vector<uint8_t>& out, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T value) {
+    put(out, &value, sizeof(value));
+}
+
+// Bounds-checked reads over an encoded result
+struct Reader {
+    const std::vector<uint8_t>& data;
+    size_t at = 0;
+    bool ok = true;
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (at + sizeof(T) > data.size()) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data.data() + at, sizeof(T));
+        at += sizeof(T);
+        return value;
+    }
+};
+
+// Encoded result, all indices canonical:
+//   item count, bin count;
+//   per bin in packer order: its canonical index, item count, items in placement order;
+//   unfit count, unfit items;
+//   per item: x, y, z, rotation.
+std::vector<uint8_t> encodeResult(const Packer& packer, const std::vector<ItemHandle>& item_order) {
+    std::vector<uint32_t> item_rank(packer.items.size());
+    for (uint32_t k = 0; k < item_order.size(); ++k) {
+        item_rank[item_order[k]] = k;
+    }
+    const auto bin_order = canonicalBins(packer).first;
+    std::vector<uint32_t> bin_rank(packer.bins.size());
+    for (uint32_t k = 0; k < bin_order.size(); ++k) {
+        bin_rank[bin_order[k]] = k;
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(8 + 8 * packer.bins.size() + 4 * packer.items.size() + 4 * packer.unfit_items.size() +
+                25 * packer.items.size());
+    put<uint32_t>(out, static_cast<uint32_t>(packer.items.size()));
+    put<uint32_t>(out, static_cast<uint32_t>(packer.bins.size()));
+    for (size_t b = 0; b < packer.bins.size(); ++b) {
+        const auto& handles = packer.bins[b].getItemHandles();
+        put<uint32_t>(out, bin_rank[b]);
+        put<uint32_t>(out, static_cast<uint32_t>(handles.size()));
+        for (ItemHandle handle : handles) {
+            put<uint32_t>(out, item_rank[handle]);
+        }
+    }
+    put<uint32_t>(out, static_cast<uint32_t>(packer.unfit_items.size()));
+    for (ItemHandle handle : packer.unfit_items) {
+        put<uint32_t>(out, item_rank[handle]);
+    }
+    for (ItemHandle handle : item_order) {
+        const Item& item = packer.items[handle];
+        const auto& [x, y, z] = item.getPosition();
+        put<int64_t>(out, x);
+        put<int64_t>(out, y);
+        put<int64_t>(out, z);
+        put<uint8_t>(out, static_cast<uint8_t>(item.getRotationType()));
+    }
+    return out;
+}
+
+} // namespace
+
+ProblemHash problemHash(const Packer& packer) {
+    return combine(canonicalItems(packer).second, canonicalBins(packer).second);
+}
+
+ProblemHash problemHash(const Packer& packer, const PackOptions& options) {
+    return withOptions(problemHash(packer), options);
+}
+
+ResultCache::ResultCache(size_t max_bytes) : max_bytes(max_bytes) {}
+
+ResultCache::~ResultCache() {
+    closeFile();
+}
+
+size_t ResultCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hit_count;
+}
+
+size_t ResultCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return miss_count;
+}
+
+size_t ResultCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t ResultCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used_bytes;
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    lookup.clear();
+    used_bytes = 0;
+}
+
+bool ResultCache::pack(Packer& packer, const PackOptions& options) {
+    const auto start = Clock::now();
+    const auto [item_order, items_hash] = canonicalItems(packer);
+    const auto [bin_order, bins_hash] = canonicalBins(packer);
+    const ProblemHash key = withOptions(combine(items_hash, bins_hash), options);
+
+    // The pack itself runs unlocked, so concurrent misses pack in parallel
+    std::vector<uint8_t> stored;
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        found = find(key, stored);
+    }
+    if (found && replay(packer, item_order, bin_order, stored)) {
+        packer.options = options;
+        packer.pack_stats = PackStats{};
+        packer.pack_stats.seconds_total = std::chrono::duration<double>(Clock::now() - start).count();
+        packer.pack_truncated = false;
+        std::lock_guard<std::mutex> lock(mutex);
+        ++hit_count;
+        log_info("cache", "hit", LogField("items", packer.items.size()), LogField("bins", packer.bins.size()));
+        return true;
+    }
+
+    packer.pack(options);
+    std::vector<uint8_t> result;
+    if (!packer.truncated()) {
+        result = encodeResult(packer, item_order);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    ++miss_count;
+    if (!result.empty()) {
+        storeOnDisk(key, result);
+        remember(key, std::move(result));
+    }
+    return false;
+}
+
+bool ResultCache::replay(Packer& packer, const std::vector<ItemHandle>& item_order,
+                         const std::vector<uint32_t>& bin_order, const std::vector<uint8_t>& stored) {
+    // Decode and check everything before touching the packer
+    Reader in{stored};
+    const uint32_t item_count = in.get<uint32_t>();
+    const uint32_t bin_count = in.get<uint32_t>();
+    if (!in.ok || item_count != item_order.size() || bin_count != bin_order.size()) {
+        return false;
+    }
+    std::vector<uint8_t> seen(item_count, 0);
+    auto item = [&](uint32_t rank) -> ItemHandle {
+        if (rank >= item_count || seen[rank]) {
+            in.ok = false;
+            return 0;
+        }
+        seen[rank] = 1;
+        return item_order[rank];
+    };
+
+    std::vector<uint8_t> bin_used(bin_count, 0);
+    std::vector<Bin> bins;
+    bins.reserve(bin_count);
+    std::vector<std::vector<ItemHandle>> contents(bin_count);
+    for (uint32_t b = 0; b < bin_count && in.ok; ++b) {
+        const uint32_t rank = in.get<uint32_t>();
+        const uint32_t count = in.get<uint32_t>();
+        if (!in.ok || rank >= bin_count || bin_used[rank] || count > item_count) {
+            return false;
+        }
+        bin_used[rank] = 1;
+        bins.push_back(packer.bins[bin_order[rank]]);
+        contents[b].reserve(count);
+        for (uint32_t i = 0; i < count && in.ok; ++i) {
+            contents[b].push_back(item(in.get<uint32_t>()));
+        }
+    }
+    const uint32_t unfit_count = in.get<uint32_t>();
+    if (!in.ok || unfit_count > item_count) {
+        return false;
+    }
+    std::vector<ItemHandle> unfit;
+    unfit.reserve(unfit_count);
+    for (uint32_t i = 0; i < unfit_count && in.ok; ++i) {
+        unfit.push_back(item(in.get<uint32_t>()));
+    }
+    const size_t placement_bytes = static_cast<size_t>(item_count) * (3 * sizeof(int64_t) + 1);
+    if (!in.ok || in.at + placement_bytes != stored.size() ||
+        std::count(seen.begin(), seen.end(), 1) != static_cast<long>(item_count)) {
+        return false;
+    }
+
+    for (ItemHandle handle : item_order) {
+        const auto x = in.get<int64_t>();
+        const auto y = in.get<int64_t>();
+        const auto z = in.get<int64_t>();
+        const auto rotation = in.get<uint8_t>();
+        Item& unit = packer.items[handle];
+        unit.setRotationType(static_cast<RotationType>(std::min<uint8_t>(rotation, 5)));
+        unit.setPosition({x, y, z});
+    }
+    packer.bins = std::move(bins);
+    for (uint32_t b = 0; b < bin_count; ++b) {
+        packer.bins[b].attach(&packer.items);
+        packer.bins[b].setItems(contents[b]);
+    }
+    packer.unfit_items = std::move(unfit);
+    return true;
+}
+
+bool ResultCache::find(const ProblemHash& key, std::vector<uint8_t>& result) {
+    auto it = lookup.find(key);
+    if (it != lookup.end()) {
+        entries.splice(entries.begin(), entries, it->second);
+        result = it->second->result;
+        return true;
+    }
+    auto on_disk = file_index.find(key);
+    if (on_disk == file_index.end()) {
+        return false;
+    }
+    const uint8_t* record = mapped + on_disk->second;
+    uint64_t size, sum;
+    std::memcpy(&size, record + 16, sizeof(size));
+    std::memcpy(&sum, record + 24, sizeof(sum));
+    if (checksum(record + RECORD_BYTES, size) != sum) {
+        file_index.erase(on_disk);
+        return false;
+    }
+    result.assign(record + RECORD_BYTES, record + RECORD_BYTES + size);
+    remember(key, result);
+    return true;
+}
+
+void ResultCache::remember(const ProblemHash& key, std::vector<uint8_t> result) {
+    const size_t cost = result.size() + ENTRY_OVERHEAD;
+    if (cost > max_bytes) {
+        return;
+    }
+    auto it = lookup.find(key);
+    if (it != lookup.end()) {
+        used_bytes -= it->second->result.size() + ENTRY_OVERHEAD;
+        entries.erase(it->second);
+        lookup.erase(it);
+    }
+    entries.push_front(Entry{key, std::move(result)});
+    lookup[key] = entries.begin();
+    used_bytes += cost;
+    evict();
+}
+
+void ResultCache::evict() {
+    while (used_bytes > max_bytes && !entries.empty()) {
+        const Entry& oldest = entries.back();
+        used_bytes -= oldest.result.size() + ENTRY_OVERHEAD;
+        lookup.erase(oldest.key);
+        entries.pop_back();
+    }
+}
+
+// File layout: the header, then records of key, payload size, checksum and
+// payload, each padded to 8 bytes. A record only counts once the header's
+// end offset has moved past it.
+bool ResultCache::openFile(const std::string& path, size_t file_bytes) {
+    closeFile();
+#ifdef RESULT_CACHE_MMAP
+    std::lock_guard<std::mutex> lock(mutex);
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = std::max({static_cast<size_t>(info.st_size), file_bytes, HEADER_BYTES});
+    if (static_cast<size_t>(info.st_size) < size && ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void* region = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (region == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    file = fd;
+    mapped = static_cast<uint8_t*>(region);
+    mapped_bytes = size;
+    loadFileIndex();
+    log_info("cache", "file_opened", LogField("bytes", mapped_bytes), LogField("entries", file_index.size()));
+    return true;
+#else
+    (void)path;
+    (void)file_bytes;
+    return false;
+#endif
+}
+
+void ResultCache::closeFile() {
+    std::lock_guard<std::mutex> lock(mutex);
+#ifdef RESULT_CACHE_MMAP
+    if (mapped) {
+        ::munmap(mapped, mapped_bytes);
+    }
+    if (file >= 0) {
+        ::close(file);
+    }
+#endif
+    mapped = nullptr;
+    mapped_bytes = 0;
+    file = -1;
+    file_index.clear();
+}
+
+void ResultCache::loadFileIndex() {
+    uint64_t capacity = 0, end = 0;
+    std::memcpy(&capacity, mapped + 8, sizeof(capacity));
+    std::memcpy(&end, mapped + 16, sizeof(end));
+    if (std::memcmp(mapped, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || capacity > mapped_bytes ||
+        end < HEADER_BYTES || end > capacity) {
+        // New or foreign file: start it over
+        std::memset(mapped, 0, HEADER_BYTES);
+        std::memcpy(mapped, FILE_MAGIC, sizeof(FILE_MAGIC));
+        capacity = 0;
+        end = HEADER_BYTES;
+        std::memcpy(mapped + 16, &end, sizeof(end));
+    }
+    if (capacity < mapped_bytes) {
+        // Grown since: the records stay, the new space goes to new ones
+        capacity = mapped_bytes;
+        std::memcpy(mapped + 8, &capacity, sizeof(capacity));
+    }
+    // Later records for a key replace earlier ones
+    for (size_t at = HEADER_BYTES; at + RECORD_BYTES <= end;) {
+        ProblemHash key;
+        uint64_t size;
+        std::memcpy(&key.high, mapped + at, sizeof(key.high));
+        std::memcpy(&key.low, mapped + at + 8, sizeof(key.low));
+        std::memcpy(&size, mapped + at + 16, sizeof(size));
+        const size_t next = at + RECORD_BYTES + ((size + 7) & ~size_t(7));
+        if (next > end) break;
+        file_index[key] = at;
+        at = next;
+    }
+}
+
+void ResultCache::storeOnDisk(const ProblemHash& key, const std::vector<uint8_t>& result) {
+    if (!mapped) {
+        return;
+    }
+    const size_t record = RECORD_BYTES + ((result.size() + 7) & ~size_t(7));
+    if (record > mapped_bytes - HEADER_BYTES) {
+        return;
+    }
+    uint64_t end;
+    std::memcpy(&end, mapped + 16, sizeof(end));
+    if (end + record > mapped_bytes) {
+        end = HEADER_BYTES;
+        file_index.clear();
+    }
+    uint8_t* at = mapped + end;
+    const uint64_t size = result.size();
+    const uint64_t sum = checksum(result.data(), result.size());
+    std::memcpy(at, &key.high, sizeof(key.high));
+    std::memcpy(at + 8, &key.low, sizeof(key.low));
+    std::memcpy(at + 16, &size, sizeof(size));
+    std::memcpy(at + 24, &sum, sizeof(sum));
+    std::memcpy(at + RECORD_BYTES, result.data(), result.size());
+    file_index[key] = end;
+    // Publish the record last
+    end += record;
+    std::memcpy(mapped + 16, &end, sizeof(end));
+}
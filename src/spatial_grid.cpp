@@ -0,0 +1,85 @@
+#include "spatial_grid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Aim for a few thousand cells per bin, with no axis split more than 64 ways.
+constexpr double TARGET_CELLS = 4096.0;
+constexpr long MAX_CELLS_PER_AXIS = 64;
+}
+
+void SpatialGrid::reset(long width, long height, long depth) {
+    extent_ = {width, height, depth};
+    const std::array<long, 3> dims = {std::max(1L, width), std::max(1L, height), std::max(1L, depth)};
+    const double volume = static_cast<double>(dims[0]) * dims[1] * dims[2];
+    const long edge = std::max(1L, static_cast<long>(std::ceil(std::cbrt(volume / TARGET_CELLS))));
+
+    for (size_t axis = 0; axis < 3; ++axis) {
+        cell_count_[axis] = std::min(MAX_CELLS_PER_AXIS, (dims[axis] + edge - 1) / edge);
+        cell_size_[axis] = (dims[axis] + cell_count_[axis] - 1) / cell_count_[axis];
+    }
+    cells_.assign(cell_count_[0] * cell_count_[1] * cell_count_[2], {});
+    count_ = 0;
+    stamps_.clear();
+    epoch_ = 0;
+}
+
+void SpatialGrid::clear() {
+    for (auto& cell : cells_) {
+        cell.clear();
+    }
+    count_ = 0;
+    stamps_.clear();
+    epoch_ = 0;
+}
+
+bool SpatialGrid::cellRange(const Aabb& box, std::array<long, 3>& lo, std::array<long, 3>& hi) const {
+    if (cells_.empty()) {
+        return false;
+    }
+    for (size_t axis = 0; axis < 3; ++axis) {
+        if (box.max[axis] <= box.min[axis]) {
+            return false;
+        }
+        lo[axis] = std::clamp(box.min[axis] / cell_size_[axis], 0L, cell_count_[axis] - 1);
+        hi[axis] = std::clamp((box.max[axis] - 1) / cell_size_[axis], 0L, cell_count_[axis] - 1);
+    }
+    return true;
+}
+
+void SpatialGrid::insert(uint32_t id, const Aabb& box) {
+    if (stamps_.size() <= id) {
+        stamps_.resize(id + 1, 0);
+    }
+    ++count_;
+    std::array<long, 3> lo, hi;
+    if (!cellRange(box, lo, hi)) {
+        return;
+    }
+    for (long cy = lo[1]; cy <= hi[1]; ++cy) {
+        for (long cz = lo[2]; cz <= hi[2]; ++cz) {
+            for (long cx = lo[0]; cx <= hi[0]; ++cx) {
+                cells_[(cy * cell_count_[2] + cz) * cell_count_[0] + cx].push_back(id);
+            }
+        }
+    }
+}
+
+void SpatialGrid::removeLast(uint32_t id, const Aabb& box) {
+    --count_;
+    std::array<long, 3> lo, hi;
+    if (!cellRange(box, lo, hi)) {
+        return;
+    }
+    // Cells list ids in insertion order, so the last box is at the back of each
+    for (long cy = lo[1]; cy <= hi[1]; ++cy) {
+        for (long cz = lo[2]; cz <= hi[2]; ++cz) {
+            for (long cx = lo[0]; cx <= hi[0]; ++cx) {
+                auto& cell = cells_[(cy * cell_count_[2] + cz) * cell_count_[0] + cx];
+                if (!cell.empty() && cell.back() == id) {
+                    cell.pop_back();
+                }
+            }
+        }
+    }
+}
@@ -1,4 +1,5 @@
 import unittest
+import numpy as np
 import pybinding
 
 class TestPybinding(unittest.TestCase):
@@ -11,7 +12,7 @@ class TestPybinding(unittest.TestCase):
                     pybinding.Bin('Le grande box', 100, 100, 300),
                 ],
                 "items": [
-                    pybinding.Item('Item 1', 150, 50, 50, [pybinding.RotationType.whd], "red"),
+                    pybinding.Item('Item 1', 150, 50, 50, [], "red"),
                 ],
                 "expectation": lambda packer: len(packer.get_bins()[0].get_items()) == 1 and len(packer.get_unfit_items()) == 0,
             },
@@ -21,7 +22,7 @@ class TestPybinding(unittest.TestCase):
                     pybinding.Bin('Le grande box', 100, 100, 300),
                 ],
                 "items": [
-                    pybinding.Item('Item 1', 150, 50, 50, [pybinding.RotationType.whd], "red"),
+                    pybinding.Item('Item 1', 150, 50, 50, [pybinding.RotationType.whd, pybinding.RotationType.dhw], "red"),
                 ],
                 "expectation": lambda packer: len(packer.get_bins()[0].get_items()) == 1 and len(packer.get_unfit_items()) == 0,
             },
@@ -32,9 +33,9 @@ class TestPybinding(unittest.TestCase):
                     pybinding.Bin("2. Le grande box", 2960, 2960, 80),
                 ],
                 "items": [
-                    pybinding.Item("Item 1", 250, 250, 2, [pybinding.RotationType.whd], "red"),
-                    pybinding.Item("Item 2", 250, 2, 250, [pybinding.RotationType.whd], "red"),
-                    pybinding.Item("Item 3", 2, 250, 250, [pybinding.RotationType.whd], "red"),
+                    pybinding.Item("Item 1", 250, 250, 2, [], "red"),
+                    pybinding.Item("Item 2", 250, 2, 250, [], "red"),
+                    pybinding.Item("Item 3", 2, 250, 250, [], "red"),
                 ],
                 "expectation": lambda packer: (
                     packer.get_bins()[0].get_name() == '1. Le petite box' and
@@ -74,5 +75,251 @@ class TestPybinding(unittest.TestCase):
                 packer.pack()
                 self.assertTrue(test_data["expectation"](packer))
 
+    def test_pack_many(self):
+        packers = []
+        for test_data in self.test_datas:
+            packer = pybinding.Packer()
+            for bin_ in test_data["bins"]:
+                packer.add_bin(bin_)
+            for item in test_data["items"]:
+                packer.add_item(item)
+            packers.append(packer)
+        pybinding.pack_many(packers, threads=2)
+        for test_data, packer in zip(self.test_datas, packers):
+            with self.subTest(test_data["name"]):
+                self.assertTrue(test_data["expectation"](packer))
+
+    def test_pack_async(self):
+        test_data = self.test_datas[0]
+        packer = pybinding.Packer()
+        for bin_ in test_data["bins"]:
+            packer.add_bin(bin_)
+        for item in test_data["items"]:
+            packer.add_item(item)
+        future = pybinding.pack_async(packer)
+        self.assertIs(future.result(), packer)
+        self.assertTrue(future.done())
+        self.assertTrue(test_data["expectation"](packer))
+
+    def test_bulk_arrays(self):
+        packer = pybinding.Packer()
+        packer.add_bin(pybinding.Bin("Bin 1", 100, 100, 100))
+        dims = np.array([[50, 100, 100], [100, 100, 100], [50, 100, 100]], dtype=np.int64)
+        packer.add_items_array(dims, rotation_masks=np.ones(3, dtype=np.uint8))
+        packer.pack()
+        result = packer.placements_array()
+        self.assertEqual(result["bin_index"].tolist(), [-1, 0, -1])
+        self.assertEqual(result["dimension"][1].tolist(), [100, 100, 100])
+        self.assertEqual(result["position"].shape, (3, 3))
+        self.assertEqual(result["position"][0].tolist(), [0, 0, 0])
+        self.assertEqual(result["dimension"][2].tolist(), [0, 0, 0])
+
+    def test_stats(self):
+        packer = pybinding.Packer()
+        packer.add_bin(pybinding.Bin("Bin 1", 100, 100, 100))
+        packer.add_item(pybinding.Item("Item 1", 100, 100, 100))
+        packer.add_item(pybinding.Item("Item 2", 50, 50, 50))
+        packer.pack()
+        stats = packer.stats()
+        self.assertEqual(stats.packs_run, 1)
+        self.assertGreater(stats.put_attempts, stats.put_accepted)
+        self.assertGreater(stats.rejected_overlap, 0)
+
+    def test_reset(self):
+        packer = pybinding.Packer()
+        packer.add_bin(pybinding.Bin("Bin 1", 100, 100, 100))
+        for order in range(2):
+            packer.reset()
+            packer.add_item(pybinding.Item("Item 1", 50, 50, 50))
+            packer.pack()
+            self.assertEqual(len(packer.get_items()), 1)
+            self.assertEqual(len(packer.get_bins()[0].get_items()), 1)
+
+    def test_item_types(self):
+        packer = pybinding.Packer()
+        packer.add_bin(pybinding.Bin("Bin 1", 100, 100, 100))
+        packer.add_item_type([50, 50, 50], quantity=8, name="Cube")
+        packer.add_item(pybinding.Item("Cube", 50, 50, 50))
+        self.assertEqual(packer.item_type_count(), 1)
+        packer.pack()
+        self.assertEqual(len(packer.get_bins()[0].get_items()), 8)
+        self.assertEqual(len(packer.get_unfit_items()), 1)
+
+    def test_block_building(self):
+        for block_building in (True, False):
+            packer = pybinding.Packer()
+            packer.add_bin(pybinding.Bin("Bin 1", 200, 100, 100))
+            packer.add_item_type([50, 50, 50], quantity=16, name="Carton")
+            options = pybinding.PackOptions()
+            options.block_building = block_building
+            packer.pack(options)
+            self.assertEqual(len(packer.get_bins()[0].get_items()), 16)
+            self.assertEqual(packer.stats().blocks_placed > 0, block_building)
+
+    def test_support(self):
+        packer = pybinding.Packer()
+        bin = pybinding.Bin("Bin 1", 100, 100, 100)
+        bin.min_support = 0.9
+        packer.add_bin(bin)
+        packer.add_item_type([100, 40, 100], quantity=1, name="Base")
+        packer.add_item_type([30, 30, 30], quantity=6, name="Cube")
+        packer.pack()
+        bin = packer.get_bins()[0]
+        for item in bin.get_items():
+            self.assertGreaterEqual(bin.support_ratio(item), 0.9)
+
+    def test_rollback(self):
+        bin = pybinding.Bin("Bin 1", 100, 100, 100)
+        item = pybinding.Item("Item 1", 50, 50, 50)
+        self.assertTrue(bin.put_item(item, (0, 0, 0)))
+        points = bin.get_extreme_points()
+        mark = bin.mark()
+        self.assertTrue(bin.put_item(pybinding.Item("Item 2", 50, 50, 50), points[0]))
+        bin.rollback(mark)
+        self.assertEqual(len(bin.item_handles), 1)
+        self.assertEqual(bin.get_extreme_points(), points)
+
+    def test_improve(self):
+        packer = pybinding.Packer()
+        packer.add_bin(pybinding.Bin("Bin 1", 100, 100, 100))
+        for w, h, d in [(50, 80, 30), (20, 90, 100), (80, 90, 20), (70, 90, 40), (20, 10, 50)]:
+            packer.add_item_type([w, h, d], [pybinding.RotationType.whd])
+        options = pybinding.PackOptions()
+        options.improve_iterations = 100
+        options.acceptance = pybinding.SearchAcceptance.late_acceptance
+        packer.pack(options)
+        self.assertEqual(len(packer.get_unfit_items()), 0)
+        self.assertGreater(packer.stats().improve_moves, 0)
+
+    def test_deadline(self):
+        packer = pybinding.Packer()
+        packer.add_bin(pybinding.Bin("Bin 1", 100, 100, 100))
+        packer.add_item_type([10, 10, 10], quantity=500)
+        options = pybinding.PackOptions()
+        self.assertIsNone(options.time_limit)
+        options.cancel_token.cancel()
+        packer.pack(options)
+        self.assertTrue(packer.truncated())
+        self.assertEqual(len(packer.get_unfit_items()), 500)
+
+        packer.reset()
+        packer.add_item_type([10, 10, 10], quantity=500)
+        options = pybinding.PackOptions()
+        options.time_limit = 5.0
+        options.improve_seconds = 5.0
+        # Cancelled before it starts, so the pack is cut short however fast
+        # this machine is; every unit must still end up in a bin or unfit
+        options.cancel_token.cancel()
+        future = pybinding.pack_async(packer, options)
+        future.cancel()
+        future.result()
+        self.assertTrue(packer.truncated())
+        packed = sum(len(bin.get_items()) for bin in packer.get_bins())
+        self.assertEqual(packed + len(packer.get_unfit_items()), 500)
+        self.assertEqual(packer.stats().improve_best, 0)
+        self.assertEqual(options.time_limit, 5.0)
+
+        # Cancelling one call leaves the caller's token alone
+        packer.reset()
+        packer.add_item_type([10, 10, 10], quantity=500)
+        options = pybinding.PackOptions()
+        future = pybinding.pack_async(packer, options)
+        future.cancel()
+        future.result()
+        self.assertFalse(options.cancel_token.cancelled())
+
+    def test_pallets(self):
+        packer = pybinding.PalletPacker(pybinding.Pallet(1200, 800, 150, 1800, 1000))
+        packer.add_bin(pybinding.Bin("Container", 2350, 2390, 12000))
+        for _ in range(200):
+            packer.add_item(pybinding.Item("Carton", 400, 300, 250, [], "#000000", 10.0))
+        packer.pack()
+        self.assertEqual(len(packer.unfit_items), 0)
+        self.assertGreaterEqual(len(packer.pallets), 2)
+        for pallet in packer.pallets:
+            self.assertLessEqual(pallet.current_weight, 1000)
+            self.assertLessEqual(pallet.current_height, 1800)
+        placements = packer.placements_array()
+        self.assertTrue(np.all(placements["bin_index"] == 0))
+        self.assertTrue(np.all(placements["position"][:, 1] >= 150))
+
+    def test_bounds(self):
+        packer = pybinding.Packer()
+        for _ in range(8):
+            packer.add_bin(pybinding.Bin("Bin", 100, 100, 100))
+        packer.add_item_type([60, 60, 60], quantity=7)
+        packer.add_item(pybinding.Item("Pole", 200, 10, 10, [pybinding.RotationType.whd]))
+        bounds = packer.bounds()
+        self.assertEqual(bounds.volume, 2)
+        self.assertEqual(bounds.l1, 7)
+        self.assertEqual(bounds.unfit, 1)
+        self.assertEqual(bounds.lower, 7)
+        packer.pack()
+        self.assertEqual(packer.stats().prefiltered_unfit, 1)
+        self.assertEqual(len(packer.get_unfit_items()), 1)
+
+    def test_load_totals(self):
+        packer = pybinding.Packer()
+        packer.add_bin(pybinding.Bin("Bin", 100, 100, 100, 50.0))
+        packer.add_item_type([20, 20, 20], weight=10.0, quantity=10)
+        packer.pack()
+        bin = packer.get_bins()[0]
+        self.assertEqual(bin.load_weight, 50)
+        self.assertEqual(bin.load_volume, 5 * 20 ** 3)
+        self.assertAlmostEqual(bin.fill_ratio, 0.04)
+        self.assertEqual(len(packer.get_unfit_items()), 5)
+        self.assertAlmostEqual(sum(bin.axle_loads), 50)
+        self.assertEqual(len(bin.centre_of_gravity), 3)
+
+        bin.cog_envelope = pybinding.CogEnvelope([40, 0, 0], [60, 100, 100])
+        self.assertTrue(bin.cog_envelope.enabled)
+
+    def test_result_cache(self):
+        def quote(names, sizes):
+            packer = pybinding.Packer()
+            packer.add_bin(pybinding.Bin("Bin", 100, 100, 100))
+            for name, size in zip(names, sizes):
+                packer.add_item(pybinding.Item(name, *size))
+            return packer
+
+        sizes = [(50, 50, 50), (30, 40, 50), (60, 20, 10)]
+        first = quote(["a", "b", "c"], sizes)
+        second = quote(["z", "y", "x"], sizes[::-1])
+        self.assertEqual(pybinding.problem_hash(first), pybinding.problem_hash(second))
+
+        cache = pybinding.ResultCache()
+        self.assertFalse(cache.pack(first))
+        self.assertTrue(cache.pack(second))
+        self.assertEqual((cache.hits, cache.misses, cache.size), (1, 1, 1))
+        self.assertEqual({item.name for item in second.get_bins()[0].get_items()}, {"x", "y", "z"})
+
+    def test_place_online(self):
+        packer = pybinding.Packer()
+        packer.add_bin(pybinding.Bin("Bin", 20, 20, 20))
+        packer.add_bin(pybinding.Bin("Bin", 20, 20, 20))
+        first = packer.place(pybinding.Item("a", 10, 10, 10))
+        self.assertTrue(first.placed)
+        self.assertTrue(first.opened_bin)
+        self.assertEqual((first.bin, first.position), (0, (0, 0, 0)))
+        for _ in range(7):
+            self.assertEqual(packer.place(pybinding.Item("b", 10, 10, 10)).bin, 0)
+        spill = packer.place(pybinding.Item("c", 10, 10, 10))
+        self.assertEqual((spill.bin, spill.opened_bin), (1, True))
+        self.assertFalse(packer.place(pybinding.Item("d", 30, 30, 30)).placed)
+        self.assertEqual(len(packer.get_unfit_items()), 1)
+
+    def test_bins_own_their_items(self):
+        bin = pybinding.Bin("Loose", 100, 100, 100)
+        self.assertTrue(bin.put_item(pybinding.Item("A", 50, 50, 50), (0, 0, 0)))
+        self.assertEqual([item.name for item in bin.get_items()], ["A"])
+
+        packer = pybinding.Packer()
+        packer.add_bin(pybinding.Bin("Bin", 100, 100, 100))
+        packer.add_item_type([50, 50, 50], quantity=3)
+        packer.pack()
+        bins = packer.get_bins()
+        del packer
+        self.assertEqual(len(bins[0].items), 3)
+
 if __name__ == "__main__":
     unittest.main()
\ No newline at end of file
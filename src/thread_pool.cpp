@@ -0,0 +1,98 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace {
+// Which pool and queue the current thread works for, if any
+thread_local const void* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i]() { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> job) {
+    // Workers keep what they spawn; outside callers spread jobs out
+    const size_t target = current_pool == this
+        ? current_queue
+        : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->jobs.push_back(std::move(job));
+    }
+    // Bumped after the push, so a worker that saw the old value and then
+    // found every queue empty is woken for this job
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        ++published;
+    }
+    ready.notify_one();
+}
+
+bool ThreadPool::takeJob(size_t self, std::function<void()>& job) {
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue& victim = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(size_t self) {
+    current_pool = this;
+    current_queue = self;
+    for (;;) {
+        uint64_t seen;
+        bool stop;
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            seen = published;
+            stop = stopping;
+        }
+        std::function<void()> job;
+        if (takeJob(self, job)) {
+            job();
+            continue;
+        }
+        // Every job published before `seen` was read is taken or running, so
+        // sleep until a new one is, however long the running ones take
+        if (stop) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        ready.wait(lock, [this, seen]() { return stopping || published != seen; });
+    }
+}